@@ -26,6 +26,8 @@
 
 #include "llvm-DenseMap.h"
 #include "llvm-DenseSet.h"
+#include <atomic>
+#include <string.h>
 
 namespace objc {
 
@@ -83,6 +85,63 @@ class ExplicitInitDenseSet : public ExplicitInit<DenseSet<Value>> { };
 template <typename Value>
 class LazyInitDenseSet : public LazyInit<DenseSet<Value>> { };
 
+// Values parsed from C strings, interned by the strings' contents and 
+// never freed. Each value keeps its own copy of its string in Key, so 
+// it outlives the caller's string.
+//
+// A small lock-free table remembers the values of recently used string 
+// pointers. Most callers pass the same pointer every time, so they 
+// find it there with one strcmp() and no hashing. The strcmp() catches 
+// a different string at a reused address.
+//
+// RecentCount must be a power of two.
+template <typename Value, const char * Value::*Key, unsigned RecentCount>
+class InternedStringCache {
+    static_assert((RecentCount & (RecentCount - 1)) == 0,
+                  "RecentCount must be a power of two");
+
+    LazyInitDenseMap<const char *, Value *> _interned;
+    std::atomic<const char *> _recentStrings[RecentCount];
+    std::atomic<const Value *> _recentValues[RecentCount];
+
+public:
+    // Returns the value for string, calling parse(string) with lock 
+    // held if no value has been interned for its contents yet.
+    template <typename Lock, typename Parse>
+    const Value *get(Lock& lock, const char *string, Parse parse) {
+        unsigned index = 
+            (unsigned)(((uintptr_t)string >> 3) & (RecentCount - 1));
+        if (_recentStrings[index].load(std::memory_order_acquire) == string) {
+            auto *value = _recentValues[index].load(std::memory_order_acquire);
+            // Recheck in case another thread replaced both in between.
+            if (value  &&  
+                _recentStrings[index].load(std::memory_order_acquire) == string  &&
+                0 == strcmp(value->*Key, string))
+            {
+                return value;
+            }
+        }
+
+        typename Lock::locker locker(lock);
+        auto& map = *_interned.get(true);
+        Value *value;
+        auto it = map.find(string);
+        if (it != map.end()) {
+            value = it->second;
+        } else {
+            value = parse(string);
+            map[value->*Key] = value;
+        }
+
+        // Clear the pointer first so a reader never pairs the new 
+        // pointer with the old value.
+        _recentStrings[index].store(nullptr, std::memory_order_release);
+        _recentValues[index].store(value, std::memory_order_release);
+        _recentStrings[index].store(string, std::memory_order_release);
+        return value;
+    }
+};
+
 } // namespace objc
 
 #endif /* DENSEMAPEXTRAS_H */
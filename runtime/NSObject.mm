@@ -155,6 +155,9 @@ struct SideTable {
     spinlock_t slock;
     RefcountMap refcnts;
     weak_table_t weak_table;
+#if ISA_HAS_BIASED_RC_BIT
+    RefcountMap biasDebts;  // see "Deferred retain counts"
+#endif
 
     SideTable() {
         memset(&weak_table, 0, sizeof(weak_table));
@@ -321,6 +324,12 @@ objc_storeStrong(id *location, id obj)
 }
 
 
+#if __OBJC2__
+namespace objc {
+static void pendingReleaseEscape(objc_object *obj);
+}
+#endif
+
 // Update a weak variable.
 // If HaveOld is true, the variable has an existing value 
 //   that needs to be cleaned up. This value might be nil.
@@ -340,6 +349,14 @@ storeWeak(id *location, objc_object *newObj)
     ASSERT(haveOld  ||  haveNew);
     if (!haveNew) ASSERT(newObj == nil);
 
+#if __OBJC2__
+    if (slowpath(CoalesceRetainRelease)  &&  haveNew  &&  
+        !newObj->isTaggedPointerOrNil())
+    {
+        objc::pendingReleaseEscape(newObj);
+    }
+#endif
+
     Class previouslyInitializedClass = nil;
     id oldObj;
     SideTable *oldTable;
@@ -1444,6 +1461,257 @@ public:
 #undef POOL_BOUNDARY
 };
 
+/***********************************************************************
+* Out-of-line retain counts (OBJC_OUT_OF_LINE_RC)
+*
+* Normally the retain counts that overflow a nonpointer isa's extra_rc 
+* live in the side table, and every transfer of RC_HALF between the isa 
+* and the side table takes the side table lock. That lock is shared with 
+* weak references and with every other object on the same stripe, which 
+* makes it a bottleneck for a few heavily shared objects.
+*
+* With OBJC_OUT_OF_LINE_RC set, an object whose side table holds no 
+* retain counts gets a counter slot the first time its extra_rc overflows.
+* Later transfers for that object take only its RCCounterLocks stripe.
+* A slot stays with its object until another object needs the slot 
+* while it holds zero. Slots of deallocated objects are reused that way.
+*
+* As with the side table, isa.has_sidetable_rc is set exactly when the 
+* counter is non-zero, and counts move only under the counter's lock. 
+* A counter is installed under the side table lock, and the side table 
+* paths of rootRetain() and rootRelease() look for a counter after 
+* taking that lock, so an object never has counts in both places.
+* Objects with a biased isa (OBJC_DEFERRED_RC) never use a counter.
+**********************************************************************/
+
+StripedMap<spinlock_t> RCCounterLocks;
+
+#if SUPPORT_NONPOINTER_ISA
+
+namespace objc {
+
+struct rc_counter_t {
+    std::atomic<objc_object *> obj;
+    size_t count;       // guarded by RCCounterLocks[obj]
+};
+
+static constexpr unsigned rcCounterSlots = 1024;    // power of two
+static constexpr unsigned rcCounterProbes = 8;
+
+static rc_counter_t *rcCounters;
+
+static inline unsigned
+rcCounterIndex(objc_object *obj)
+{
+    uintptr_t addr = (uintptr_t)obj;
+    return (unsigned)((addr >> 4) ^ (addr >> 14)) & (rcCounterSlots - 1);
+}
+
+// Lock-free. The result is only stable while the caller 
+// holds RCCounterLocks[obj] or obj's side table lock.
+static rc_counter_t *
+rcCounterFind(objc_object *obj)
+{
+    unsigned index = rcCounterIndex(obj);
+    for (unsigned i = 0; i < rcCounterProbes; i++) {
+        rc_counter_t *counter = &rcCounters[(index + i) & (rcCounterSlots-1)];
+        objc_object *slotObj = counter->obj.load(std::memory_order_relaxed);
+        if (slotObj == obj) return counter;
+        // Slots are never emptied, so no later slot can hold obj.
+        if (!slotObj) break;
+    }
+    return nil;
+}
+
+void
+rcCounterInit(void)
+{
+    rcCounters = (rc_counter_t *)calloc(rcCounterSlots, sizeof(rc_counter_t));
+}
+
+bool
+rcCounterExists(objc_object *obj)
+{
+    return rcCounterFind(obj) != nil;
+}
+
+// Gives obj a counter holding count, which obj's isa has just 
+// moved out of line. Returns false if no slot is available.
+// Locking: the caller holds obj's side table lock, 
+// and obj has no counter already.
+bool
+rcCounterInstall(objc_object *obj, size_t count)
+{
+    spinlock_t *lock = &RCCounterLocks[obj];
+    unsigned index = rcCounterIndex(obj);
+
+    // Prefer an empty slot, then one whose counter holds nothing.
+    for (int pass = 0; pass < 2; pass++) {
+        for (unsigned i = 0; i < rcCounterProbes; i++) {
+            rc_counter_t *counter = 
+                &rcCounters[(index + i) & (rcCounterSlots-1)];
+            objc_object *old = counter->obj.load(std::memory_order_relaxed);
+            if (pass == 0  &&  old) continue;
+
+            spinlock_t *oldLock = old ? &RCCounterLocks[old] : lock;
+            spinlock_t::lockTwo(lock, oldLock);
+            bool claimed = counter->count == 0  &&  
+                counter->obj.compare_exchange_strong(old, obj, 
+                                                     std::memory_order_relaxed);
+            if (claimed) counter->count = count;
+            spinlock_t::unlockTwo(lock, oldLock);
+            if (claimed) return true;
+        }
+    }
+    return false;
+}
+
+// Empties obj's counter and returns what it held.
+size_t
+rcCounterTake(objc_object *obj)
+{
+    spinlock_t& lock = RCCounterLocks[obj];
+    size_t count = 0;
+
+    lock.lock();
+    if (rc_counter_t *counter = rcCounterFind(obj)) {
+        count = counter->count;
+        counter->count = 0;
+    }
+    lock.unlock();
+    return count;
+}
+
+// Returns false if obj does not use a counter.
+bool
+rcCounterRetainCount(objc_object *obj, uintptr_t *outCount)
+{
+    spinlock_t& lock = RCCounterLocks[obj];
+    bool found = false;
+
+    lock.lock();
+    if (rc_counter_t *counter = rcCounterFind(obj)) {
+        isa_t bits = obj->isaBits();
+        if (bits.canUseRCCounter()) {
+            *outCount = bits.extra_rc;
+            if (bits.has_sidetable_rc) *outCount += counter->count;
+            found = true;
+        }
+    }
+    lock.unlock();
+    return found;
+}
+
+} // namespace objc
+
+
+// Retain whose extra_rc overflowed, for an object with a counter.
+NEVER_INLINE id
+objc_object::rootRetain_counter(bool tryRetain)
+{
+    spinlock_t& lock = RCCounterLocks[this];
+    lock.lock();
+
+    objc::rc_counter_t *counter = objc::rcCounterFind(this);
+    if (!counter) {
+        // The slot was given to another object.
+        lock.unlock();
+        return rootRetain(tryRetain, RRVariant::Full);
+    }
+
+    bool transcribe;
+    isa_t oldisa = LoadExclusive(&isa.bits);
+    isa_t newisa;
+    do {
+        transcribe = false;
+        newisa = oldisa;
+        if (slowpath(!newisa.canUseRCCounter())) {
+            // changeIsa() moved the counter to the side table.
+            ClearExclusive(&isa.bits);
+            lock.unlock();
+            return rootRetain(tryRetain, RRVariant::Full);
+        }
+        if (slowpath(newisa.isDeallocating())) {
+            ClearExclusive(&isa.bits);
+            lock.unlock();
+            return tryRetain ? nil : (id)this;
+        }
+        uintptr_t carry;
+        newisa.bits = addc(newisa.bits, RC_ONE, 0, &carry);  // extra_rc++
+        if (carry) {
+            // Leave half of the retain counts inline and 
+            // move the other half to the counter.
+            newisa.extra_rc = RC_HALF;
+            newisa.has_sidetable_rc = true;
+            transcribe = true;
+        }
+    } while (slowpath(!StoreExclusive(&isa.bits, &oldisa.bits, newisa.bits)));
+
+    if (transcribe) counter->count += RC_HALF;
+    lock.unlock();
+    return (id)this;
+}
+
+
+// Release whose extra_rc underflowed, for an object with a counter.
+// Returns true if the object should now be deallocated.
+NEVER_INLINE bool
+objc_object::rootRelease_counter(bool performDealloc)
+{
+    spinlock_t& lock = RCCounterLocks[this];
+    lock.lock();
+
+    objc::rc_counter_t *counter = objc::rcCounterFind(this);
+    if (!counter) {
+        // The slot was given to another object.
+        lock.unlock();
+        return rootRelease(performDealloc, RRVariant::Full);
+    }
+
+    size_t borrowed;
+    isa_t oldisa = LoadExclusive(&isa.bits);
+    isa_t newisa;
+    do {
+        borrowed = 0;
+        newisa = oldisa;
+        if (slowpath(!newisa.canUseRCCounter())) {
+            // changeIsa() moved the counter to the side table.
+            ClearExclusive(&isa.bits);
+            lock.unlock();
+            return rootRelease(performDealloc, RRVariant::Full);
+        }
+        if (slowpath(newisa.isDeallocating())) {
+            ClearExclusive(&isa.bits);
+            lock.unlock();
+            return false;
+        }
+        uintptr_t carry;
+        newisa.bits = subc(newisa.bits, RC_ONE, 0, &carry);  // extra_rc--
+        if (carry) {
+            // Borrow from the counter and redo the decrement. 
+            // Nothing to borrow means this was the last reference.
+            newisa = oldisa;
+            borrowed = counter->count < RC_HALF ? counter->count : RC_HALF;
+            newisa.extra_rc = borrowed ? borrowed - 1 : 0;
+            newisa.has_sidetable_rc = counter->count > borrowed;
+        }
+    } while (slowpath(!StoreReleaseExclusive(&isa.bits, &oldisa.bits, newisa.bits)));
+
+    counter->count -= borrowed;
+    lock.unlock();
+
+    if (!newisa.isDeallocating()) return false;
+
+    __c11_atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (performDealloc) {
+        ((void(*)(objc_object *, SEL))objc_msgSend)(this, @selector(dealloc));
+    }
+    return true;
+}
+
+#endif
+
+
 /***********************************************************************
 * Slow paths for inline control
 **********************************************************************/
@@ -1453,6 +1721,12 @@ public:
 NEVER_INLINE id 
 objc_object::rootRetain_overflow(bool tryRetain)
 {
+    if (slowpath(ProfileRC)) objc::rcProfileRecord(this, objc::RCProfileOverflow);
+    if (slowpath(OutOfLineRC)  &&  isa.canUseRCCounter()  &&
+        objc::rcCounterExists(this))
+    {
+        return rootRetain_counter(tryRetain);
+    }
     return rootRetain(tryRetain, RRVariant::Full);
 }
 
@@ -1460,6 +1734,12 @@ objc_object::rootRetain_overflow(bool tryRetain)
 NEVER_INLINE uintptr_t
 objc_object::rootRelease_underflow(bool performDealloc)
 {
+    if (slowpath(ProfileRC)) objc::rcProfileRecord(this, objc::RCProfileBorrow);
+    if (slowpath(OutOfLineRC)  &&  isa.canUseRCCounter()  &&
+        objc::rcCounterExists(this))
+    {
+        return rootRelease_counter(performDealloc);
+    }
     return rootRelease(performDealloc, RRVariant::Full);
 }
 
@@ -1483,6 +1763,7 @@ objc_object::clearDeallocating_slow()
     // 清空该对象绑定的 sidetable 中引用计数表，
     if (isa.has_sidetable_rc) {
         table.refcnts.erase(this);
+        if (slowpath(OutOfLineRC)) objc::rcCounterTake(this);
     }
     // 解锁
     table.unlock();
@@ -1490,6 +1771,449 @@ objc_object::clearDeallocating_slow()
 
 #endif
 
+
+/***********************************************************************
+* Deferred retain counts (OBJC_DEFERRED_RC)
+*
+* With OBJC_DEFERRED_RC set, an object allocated by the default +alloc
+* is owned by the allocating thread, which counts its own retains and
+* releases of the object in a thread-local table instead of with 
+* atomic operations on the isa. isa.biased_rc marks such objects. 
+* Other threads update the isa as usual.
+*
+* A biased object's inline count starts at RC_HALF rather than 1, so 
+* other threads can release references the owner handed to them 
+* without taking it to zero. If a release on another thread would 
+* take it to zero anyway, that thread records a debt in the side 
+* table instead (see rootRelease()), because only the owner knows 
+* how many references it still holds.
+*
+* The owner merges its count back into the isa when it releases its 
+* last reference, when it pops an autorelease pool, when the object's 
+* isa changes to a raw pointer, and when the thread exits. An object 
+* whose last reference is released on another thread is therefore 
+* deallocated by its owner, no later than the owner's next 
+* autorelease pool pop.
+*
+* Another thread that changes the object's isa to a raw pointer can't 
+* merge the owner's count. It moves the inline count to the side table
+* as usual and marks the object detached. Releases that would take the 
+* side table count to zero become debts, and the owner's next merge 
+* folds its count into the side table instead of the isa.
+**********************************************************************/
+#if ISA_HAS_BIASED_RC_BIT
+
+// Number of debts in all side tables, plus one per detached object.
+static std::atomic<uintptr_t> biasDebtCount;
+
+// Set in biasDebts for an object whose isa was changed to a raw 
+// pointer while another thread still owned its deferred count.
+static constexpr size_t BiasDetached = (size_t)1 << (sizeof(size_t)*8 - 1);
+
+// Records a release by a thread that doesn't own this object's 
+// deferred count, when that release would take its retain count 
+// to zero. Fails if the isa no longer matches oldisa.
+// Locking: caller holds the side table lock
+bool
+objc_object::sidetable_addBiasDebt_nolock(isa_t oldisa)
+{
+    ASSERT(oldisa.nonpointer  &&  oldisa.biased_rc);
+
+    // Count the debt before re-checking the isa, so that an owner
+    // whose rootMergeBias() clears biased_rc afterwards sees it.
+    biasDebtCount.fetch_add(1, std::memory_order_seq_cst);
+    uintptr_t expected = oldisa.bits;
+    if (!__c11_atomic_compare_exchange_strong((_Atomic(uintptr_t) *)&isa.bits,
+                                              &expected, oldisa.bits,
+                                              __ATOMIC_SEQ_CST,
+                                              __ATOMIC_RELAXED))
+    {
+        biasDebtCount.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    SideTable& table = SideTables()[this];
+    table.biasDebts[this]++;
+    return true;
+}
+
+
+// Removes and returns this object's debts.
+// Locking: caller holds the side table lock
+size_t
+objc_object::sidetable_takeBiasDebt_nolock()
+{
+    SideTable& table = SideTables()[this];
+    auto it = table.biasDebts.find(this);
+    if (it == table.biasDebts.end()) return 0;
+
+    size_t debt = it->second & ~BiasDetached;
+    size_t counted = debt + ((it->second & BiasDetached) ? 1 : 0);
+    table.biasDebts.erase(it);
+    biasDebtCount.fetch_sub(counted, std::memory_order_relaxed);
+    return debt;
+}
+
+
+// Marks this object detached from its owner's deferred count. 
+// Called by a thread that is not the owner, after it moved the 
+// object's count to the side table for a raw isa. The side table 
+// count still includes the RC_HALF that stands for the owner's 
+// references.
+// Locking: caller holds the side table lock
+void
+objc_object::sidetable_detachBias_nolock()
+{
+    ASSERT(!isa.nonpointer);
+
+    biasDebtCount.fetch_add(1, std::memory_order_seq_cst);
+    SideTable& table = SideTables()[this];
+    table.biasDebts[this] |= BiasDetached;
+}
+
+
+// Records a release of a detached object that would otherwise 
+// deallocate it. Returns false if the object is not detached.
+// Locking: caller holds the side table lock
+bool
+objc_object::sidetable_addDetachedBiasDebt_nolock()
+{
+    if (!biasDebtCount.load(std::memory_order_relaxed)) return false;
+
+    SideTable& table = SideTables()[this];
+    auto it = table.biasDebts.find(this);
+    if (it == table.biasDebts.end()  ||  !(it->second & BiasDetached)) {
+        return false;
+    }
+    it->second++;
+    biasDebtCount.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+
+// rootMergeBias() for a detached object. Folds the owner's deferred 
+// count `bias` and the debts into the side table count.
+// Returns true if the retain count is now zero and the caller must
+// deallocate the object.
+// Locking: caller holds the side table lock
+bool
+objc_object::sidetable_mergeBias_nolock(uintptr_t bias)
+{
+    ASSERT(!isa.nonpointer);
+
+    size_t debt = sidetable_takeBiasDebt_nolock();
+    SideTable& table = SideTables()[this];
+    size_t& refcnt = table.refcnts[this];
+    if (refcnt & SIDE_TABLE_RC_PINNED) return false;
+    ASSERT(!(refcnt & SIDE_TABLE_DEALLOCATING));
+
+    size_t flags = refcnt & SIDE_TABLE_FLAG_MASK;
+    size_t rc = (refcnt >> SIDE_TABLE_RC_SHIFT) + 1 + bias - RC_HALF - debt;
+    if (rc == 0) {
+        refcnt = flags | SIDE_TABLE_DEALLOCATING;
+        return true;
+    }
+    refcnt = ((rc - 1) << SIDE_TABLE_RC_SHIFT) | flags;
+    return false;
+}
+
+
+// Clears isa.biased_rc, folding the owner's deferred count `bias` and
+// any debts recorded by other threads back into the retain count.
+// Called by the owning thread after removing the object from its table.
+// Returns true if the retain count is now zero and the caller must
+// deallocate the object.
+bool
+objc_object::rootMergeBias(uintptr_t bias)
+{
+    isa_t oldisa = __c11_atomic_load((_Atomic uintptr_t *)&isa.bits, 
+                                     __ATOMIC_RELAXED);
+    isa_t newisa;
+
+    // Fast path: everything fits in the inline count. 
+    // The exchange is sequentially consistent to pair with
+    // sidetable_addBiasDebt_nolock().
+    while (true) {
+        // Detached by another thread. The isa can't become raw 
+        // again while the slow path holds the side table lock.
+        if (slowpath(!oldisa.nonpointer)) break;
+
+        ASSERT(oldisa.biased_rc);
+        uintptr_t rc = oldisa.extra_rc + bias;
+        if (slowpath(oldisa.has_sidetable_rc  ||  
+                     rc < RC_HALF  ||  rc - RC_HALF >= 2*RC_HALF))
+        {
+            break;
+        }
+
+        newisa = oldisa;
+        newisa.biased_rc = 0;
+        newisa.extra_rc = rc - RC_HALF;
+        if (__c11_atomic_compare_exchange_weak((_Atomic(uintptr_t) *)&isa.bits,
+                                               &oldisa.bits, newisa.bits,
+                                               __ATOMIC_SEQ_CST,
+                                               __ATOMIC_RELAXED))
+        {
+            // No other thread can have released past zero.
+            if (newisa.isDeallocating()) return true;
+
+            size_t debt = 0;
+            if (slowpath(biasDebtCount.load(std::memory_order_seq_cst))) {
+                sidetable_lock();
+                debt = sidetable_takeBiasDebt_nolock();
+                sidetable_unlock();
+            }
+            while (debt--) {
+                if (rootRelease(false, RRVariant::Fast)) {
+                    ASSERT(debt == 0);
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+
+    // Slow path: the count spans the side table, or other threads 
+    // have released more than RC_HALF of the owner's references.
+    // Recompute everything with the side table locked.
+    sidetable_lock();
+    oldisa = __c11_atomic_load((_Atomic uintptr_t *)&isa.bits, __ATOMIC_RELAXED);
+    if (!oldisa.nonpointer) {
+        bool dealloc = sidetable_mergeBias_nolock(bias);
+        sidetable_unlock();
+        return dealloc;
+    }
+
+    size_t debt = sidetable_takeBiasDebt_nolock();
+    size_t sidetableRC;
+    uintptr_t rc;
+    do {
+        ASSERT(oldisa.nonpointer  &&  oldisa.biased_rc);
+        rc = oldisa.extra_rc + bias - RC_HALF - debt;
+        if (oldisa.has_sidetable_rc) rc += sidetable_getExtraRC_nolock();
+
+        newisa = oldisa;
+        newisa.biased_rc = 0;
+        if (rc < 2*RC_HALF) {
+            newisa.extra_rc = rc;
+            newisa.has_sidetable_rc = false;
+            sidetableRC = 0;
+        } else {
+            newisa.extra_rc = RC_HALF;
+            newisa.has_sidetable_rc = true;
+            sidetableRC = rc - RC_HALF;
+        }
+    } while (!__c11_atomic_compare_exchange_weak((_Atomic(uintptr_t) *)&isa.bits,
+                                                 &oldisa.bits, newisa.bits,
+                                                 __ATOMIC_SEQ_CST,
+                                                 __ATOMIC_RELAXED));
+
+    if (oldisa.has_sidetable_rc) sidetable_clearExtraRC_nolock();
+    if (sidetableRC) sidetable_addExtraRC_nolock(sidetableRC);
+    sidetable_unlock();
+
+    return rc == 0;
+}
+
+
+namespace objc {
+
+static constexpr unsigned biasTableSize = 256;      // power of two
+static constexpr unsigned biasTableMaxCount = 192;  // keep probes short
+
+struct bias_entry_t {
+    objc_object *obj;
+    uintptr_t bias;     // references held by the owning thread
+};
+
+struct bias_table_t {
+    unsigned count;
+    bias_entry_t entries[biasTableSize];
+};
+
+static inline unsigned
+biasTableIndex(objc_object *obj)
+{
+    uintptr_t addr = (uintptr_t)obj;
+    return (unsigned)((addr >> 4) ^ (addr >> 12)) & (biasTableSize - 1);
+}
+
+static ALWAYS_INLINE bias_entry_t *
+biasTableFind(objc_object *obj)
+{
+    auto *table = (bias_table_t *)tls_get_direct(RC_BIAS_DIRECT_KEY);
+    if (!table) return nil;
+
+    for (unsigned i = biasTableIndex(obj); ; i = (i + 1) & (biasTableSize-1)) {
+        bias_entry_t *entry = &table->entries[i];
+        if (entry->obj == obj) return entry;
+        if (!entry->obj) return nil;
+    }
+}
+
+// Removes an entry, moving later entries of its probe sequence 
+// back so that lookups never need tombstones.
+static void
+biasTableRemove(bias_table_t *table, bias_entry_t *entry)
+{
+    const unsigned mask = biasTableSize - 1;
+    unsigned hole = (unsigned)(entry - table->entries);
+
+    for (unsigned i = (hole + 1) & mask; 
+         table->entries[i].obj; 
+         i = (i + 1) & mask)
+    {
+        unsigned home = biasTableIndex(table->entries[i].obj);
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            table->entries[hole] = table->entries[i];
+            hole = i;
+        }
+    }
+
+    table->entries[hole].obj = nil;
+    table->count--;
+}
+
+// Merges an entry that was removed from a table,
+// deallocating the object if that was its last reference.
+static void
+biasMerge(objc_object *obj, uintptr_t bias)
+{
+    if (obj->rootMergeBias(bias)) {
+        __c11_atomic_thread_fence(__ATOMIC_ACQUIRE);
+        ((void(*)(objc_object *, SEL))objc_msgSend)(obj, @selector(dealloc));
+    }
+}
+
+// Thread exit. Other threads' rules now apply to this thread, 
+// because its table is no longer installed.
+static void
+biasTableDestroy(void *arg)
+{
+    auto *table = (bias_table_t *)arg;
+    if (!table) return;
+
+    for (unsigned i = 0; i < biasTableSize; i++) {
+        bias_entry_t entry = table->entries[i];
+        if (entry.obj) biasMerge(entry.obj, entry.bias);
+    }
+    free(table);
+}
+
+void
+rcBiasInit(void)
+{
+    int r __unused = pthread_key_init_np(RC_BIAS_DIRECT_KEY, 
+                                         &biasTableDestroy);
+    ASSERT(r == 0);
+}
+
+// Called by _class_createInstanceFromZone() before obj is published.
+void
+rcBiasAdopt(objc_object *obj)
+{
+    auto *table = (bias_table_t *)tls_get_direct(RC_BIAS_DIRECT_KEY);
+    if (slowpath(!table)) {
+        table = (bias_table_t *)calloc(1, sizeof(*table));
+        tls_set_direct(RC_BIAS_DIRECT_KEY, table);
+    }
+    // A full table leaves new objects with ordinary retain counts 
+    // until the next pool pop empties it.
+    if (table->count >= biasTableMaxCount) return;
+
+    unsigned i = biasTableIndex(obj);
+    while (table->entries[i].obj) {
+        ASSERT(table->entries[i].obj != obj);
+        i = (i + 1) & (biasTableSize - 1);
+    }
+    table->entries[i] = { obj, 1 };
+    table->count++;
+    obj->initBiasedRC();
+}
+
+bool
+rcBiasRetain(objc_object *obj)
+{
+    bias_entry_t *entry = biasTableFind(obj);
+    if (!entry) return false;
+    entry->bias++;
+    return true;
+}
+
+RCBiasRelease
+rcBiasRelease(objc_object *obj)
+{
+    bias_entry_t *entry = biasTableFind(obj);
+    if (!entry) return RCBiasRelease::NotOwner;
+    if (entry->bias > 1) {
+        entry->bias--;
+        return RCBiasRelease::Released;
+    }
+
+    auto *table = (bias_table_t *)tls_get_direct(RC_BIAS_DIRECT_KEY);
+    biasTableRemove(table, entry);
+    return obj->rootMergeBias(0) ? RCBiasRelease::Dealloc 
+                                 : RCBiasRelease::Released;
+}
+
+// Adjusts rc, the object's inline and side table counts, 
+// for its deferred count. Only the owner knows it exactly.
+// Locking: caller holds the side table lock
+uintptr_t
+rcBiasRetainCount_nolock(objc_object *obj, uintptr_t rc)
+{
+    bias_entry_t *entry = biasTableFind(obj);
+    if (!entry) {
+        // The owner holds at least one reference.
+        return rc > RC_HALF ? rc - RC_HALF + 1 : 1;
+    }
+
+    SideTable& table = SideTables()[obj];
+    auto it = table.biasDebts.find(obj);
+    size_t debt = (it == table.biasDebts.end()) ? 0 : it->second;
+    return rc + entry->bias - RC_HALF - debt;
+}
+
+// Merges obj before its isa changes to a raw pointer.
+// Returns false if this thread is not the owner. The caller then 
+// detaches obj with sidetable_detachBias_nolock() instead.
+bool
+rcBiasRelinquish(objc_object *obj)
+{
+    bias_entry_t *entry = biasTableFind(obj);
+    if (!entry) return false;
+
+    uintptr_t bias = entry->bias;
+    biasTableRemove((bias_table_t *)tls_get_direct(RC_BIAS_DIRECT_KEY), entry);
+    bool dealloc __unused = obj->rootMergeBias(bias);
+    ASSERT(!dealloc);
+    return true;
+}
+
+// Merges every object the current thread owns.
+// Called when the thread pops an autorelease pool.
+void
+rcBiasFlush(void)
+{
+    auto *table = (bias_table_t *)tls_get_direct(RC_BIAS_DIRECT_KEY);
+    if (!table  ||  table->count == 0) return;
+
+    // Deallocating one object may add or remove others. 
+    // Anything missed here is merged by a later flush.
+    for (unsigned i = 0; i < biasTableSize; i++) {
+        while (table->entries[i].obj) {
+            bias_entry_t entry = table->entries[i];
+            biasTableRemove(table, &table->entries[i]);
+            biasMerge(entry.obj, entry.bias);
+        }
+    }
+}
+
+} // namespace objc
+
+// ISA_HAS_BIASED_RC_BIT
+#endif
+
 __attribute__((noinline,used))
 id 
 objc_object::rootAutorelease2()
@@ -1825,6 +2549,13 @@ objc_object::sidetable_release(bool locked, bool performDealloc)
     if (it.second) {
         do_dealloc = true;
     } else if (refcnt < SIDE_TABLE_DEALLOCATING) {
+#if ISA_HAS_BIASED_RC_BIT
+        // The owner of a detached deferred count settles this.
+        if (slowpath(sidetable_addDetachedBiasDebt_nolock())) {
+            table.unlock();
+            return 0;
+        }
+#endif
         // SIDE_TABLE_WEAKLY_REFERENCED may be set. Don't change it.
         do_dealloc = true;
         refcnt |= SIDE_TABLE_DEALLOCATING;
@@ -1863,6 +2594,36 @@ objc_object::sidetable_clearDeallocating()
 }
 
 
+// Clears the weak references and retain count of a deallocating object.
+// The caller holds table's lock.
+void
+objc_object::clearDeallocating_nolock(SideTable& table)
+{
+    ASSERT(&table == &SideTables()[this]);
+
+#if SUPPORT_NONPOINTER_ISA
+    if (isa.nonpointer) {
+        if (isa.weakly_referenced) {
+            weak_clear_no_lock(&table.weak_table, (id)this);
+        }
+        if (isa.has_sidetable_rc) {
+            table.refcnts.erase(this);
+            if (slowpath(OutOfLineRC)) objc::rcCounterTake(this);
+        }
+        return;
+    }
+#endif
+
+    RefcountMap::iterator it = table.refcnts.find(this);
+    if (it != table.refcnts.end()) {
+        if (it->second & SIDE_TABLE_WEAKLY_REFERENCED) {
+            weak_clear_no_lock(&table.weak_table, (id)this);
+        }
+        table.refcnts.erase(it);
+    }
+}
+
+
 /***********************************************************************
 * Optimized retain/release/autorelease entrypoints
 **********************************************************************/
@@ -1870,11 +2631,202 @@ objc_object::sidetable_clearDeallocating()
 
 #if __OBJC2__
 
+/***********************************************************************
+* Retain/release coalescing (OBJC_COALESCE_RETAIN_RELEASE)
+* ARC code often releases an object and soon afterwards retains it again, 
+* e.g. across consecutive getter calls. objc_release() parks a release 
+* that cannot deallocate in a small per-thread buffer. If the same thread 
+* retains the object before the release is performed, both are dropped 
+* and the object's isa is never touched.
+*
+* Only releases are postponed. A postponed retain would not protect the 
+* object from other threads' releases. A parked release only keeps the 
+* object alive a little longer. The buffer is emptied when it overflows, 
+* at autorelease pool push and pop, and at thread exit. An object's 
+* parked releases are also performed when it escapes the thread's 
+* retain/release sequence: when it is autoreleased, and when a weak 
+* reference to it is stored.
+*
+* Deallocation can be delayed. A release is parked only if the object's
+* count shows other references, but other threads may release those 
+* references afterwards. The object then dies when this thread performs
+* the parked release, no later than its next pool push or pop.
+*
+* objc_retainAutoreleasedReturnValue() and objc_autoreleaseReturnValue()
+* need nothing extra. When their handshake succeeds neither touches the
+* retain count, and when it fails they call objc_retain() and 
+* objc_autorelease(), which cancel or perform parked releases.
+**********************************************************************/
+namespace objc {
+
+static constexpr unsigned pendingReleaseMax = 8;
+
+struct pending_releases_t {
+    unsigned count;
+    uint64_t coalesced;     // retain/release pairs dropped on this thread
+    objc_object *objs[pendingReleaseMax];
+};
+
+static inline pending_releases_t *
+pendingReleases(void)
+{
+    return (pending_releases_t *)tls_get_direct(PENDING_RELEASE_KEY);
+}
+
+// Removes and returns the oldest parked release. 
+static objc_object *
+pendingReleaseTakeOldest(pending_releases_t *pending)
+{
+    objc_object *obj = pending->objs[0];
+    pending->count--;
+    memmove(&pending->objs[0], &pending->objs[1], 
+            pending->count * sizeof(pending->objs[0]));
+    return obj;
+}
+
+// Performs every parked release. Deallocating one object may park 
+// more releases, which are performed too.
+static void
+pendingReleaseFlush(void)
+{
+    auto *pending = pendingReleases();
+    if (!pending) return;
+    while (pending->count) {
+        pendingReleaseTakeOldest(pending)->release();
+    }
+}
+
+static void
+pendingReleaseDestroy(void *arg)
+{
+    auto *pending = (pending_releases_t *)arg;
+    if (!pending) return;
+
+    // Releases performed here may need the buffer again.
+    tls_set_direct(PENDING_RELEASE_KEY, pending);
+    pendingReleaseFlush();
+    tls_set_direct(PENDING_RELEASE_KEY, nil);
+    free(pending);
+}
+
+static void
+pendingReleaseInit(void)
+{
+    int r __unused = pthread_key_init_np(PENDING_RELEASE_KEY, 
+                                         &pendingReleaseDestroy);
+    ASSERT(r == 0);
+}
+
+// Number of releases of obj parked by the current thread.
+static uintptr_t
+pendingReleaseCount(objc_object *obj)
+{
+    auto *pending = pendingReleases();
+    if (!pending) return 0;
+
+    uintptr_t count = 0;
+    for (unsigned i = 0; i < pending->count; i++) {
+        if (pending->objs[i] == obj) count++;
+    }
+    return count;
+}
+
+// Performs the current thread's parked releases of obj.
+static void
+pendingReleasePerform(pending_releases_t *pending, objc_object *obj, 
+                      uintptr_t parked)
+{
+    for (unsigned i = 0; parked  &&  i < pending->count; ) {
+        if (pending->objs[i] == obj) {
+            pending->count--;
+            memmove(&pending->objs[i], &pending->objs[i+1], 
+                    (pending->count - i) * sizeof(pending->objs[0]));
+            parked--;
+            obj->release();
+        } else {
+            i++;
+        }
+    }
+}
+
+// obj is leaving this thread's retain/release sequence.
+static NEVER_INLINE void
+pendingReleaseEscape(objc_object *obj)
+{
+    auto *pending = pendingReleases();
+    if (!pending  ||  pending->count == 0) return;
+    pendingReleasePerform(pending, obj, pendingReleaseCount(obj));
+}
+
+// Parks a release of obj if its count shows other references.
+// Returns false if the caller must release obj itself.
+static NEVER_INLINE bool
+pendingReleaseAdd(objc_object *obj)
+{
+    auto *pending = pendingReleases();
+    uintptr_t parked = pendingReleaseCount(obj);
+    if (!obj->canDeferRelease(parked)) {
+        // This may be the last reference. Perform obj's parked 
+        // releases first so that the caller's release deallocates it.
+        if (parked) pendingReleasePerform(pending, obj, parked);
+        return false;
+    }
+
+    if (slowpath(!pending)) {
+        pending = (pending_releases_t *)calloc(1, sizeof(*pending));
+        tls_set_direct(PENDING_RELEASE_KEY, pending);
+    }
+
+    if (pending->count == pendingReleaseMax) {
+        objc_object *oldest = pendingReleaseTakeOldest(pending);
+        pending->objs[pending->count++] = obj;
+        oldest->release();
+    } else {
+        pending->objs[pending->count++] = obj;
+    }
+    return true;
+}
+
+// Drops a parked release of obj in place of retaining it.
+// Returns false if the caller must retain obj itself.
+static NEVER_INLINE bool
+pendingReleaseCancel(objc_object *obj)
+{
+    auto *pending = pendingReleases();
+    if (!pending) return false;
+
+    // Most recent first: a retain usually follows its release closely.
+    for (unsigned i = pending->count; i-- > 0; ) {
+        if (pending->objs[i] == obj) {
+            pending->count--;
+            memmove(&pending->objs[i], &pending->objs[i+1], 
+                    (pending->count - i) * sizeof(pending->objs[0]));
+            pending->coalesced++;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace objc
+
+
+uint64_t
+objc_coalescedRetainReleaseCount(void)
+{
+    auto *pending = objc::pendingReleases();
+    return pending ? pending->coalesced : 0;
+}
+
+
 __attribute__((aligned(16), flatten, noinline))
 id 
 objc_retain(id obj)
 {
     if (obj->isTaggedPointerOrNil()) return obj;
+    if (slowpath(CoalesceRetainRelease)  &&  objc::pendingReleaseCancel(obj)) {
+        return obj;
+    }
     return obj->retain();
 }
 
@@ -1884,6 +2836,9 @@ void
 objc_release(id obj)
 {
     if (obj->isTaggedPointerOrNil()) return;
+    if (slowpath(CoalesceRetainRelease)  &&  objc::pendingReleaseAdd(obj)) {
+        return;
+    }
     return obj->release();
 }
 
@@ -1893,10 +2848,134 @@ id
 objc_autorelease(id obj)
 {
     if (obj->isTaggedPointerOrNil()) return obj;
+    if (slowpath(CoalesceRetainRelease)) objc::pendingReleaseEscape(obj);
     return obj->autorelease();
 }
 
 
+/***********************************************************************
+* objc_releaseObjects
+* Sends -release to each object in objects[0..count). 
+* Nil and tagged pointer entries are ignored.
+*
+* Objects with custom RR or a custom -dealloc are released one at a time.
+* Other objects that reach zero are deallocated in batches. Objects that 
+* rootDealloc() would simply free are freed with one 
+* malloc_zone_batch_free(). The rest are destructed, then their weak 
+* references and side table retain counts are cleared with each side 
+* table stripe locked once per batch rather than once per object.
+* Locking: acquires side table locks
+**********************************************************************/
+#define RELEASE_BATCH_COUNT 64
+
+// Frees the memory of objects that rootDealloc() would free directly.
+static void
+freeInstancesBatch(id *objs, unsigned count)
+{
+    malloc_zone_t *zone = malloc_default_zone();
+    unsigned batched = 0;
+
+    for (unsigned i = 0; i < count; i++) {
+        void *ptr = (void *)objs[i];
+#if SUPPORT_SEGREGATED_ALLOC
+        if (objc::slabContains(ptr)) {
+            objc::slabFree(ptr);
+            continue;
+        }
+#endif
+        // objc_constructInstance() can give memory from any
+        // allocator a nonpointer isa.
+        if (fastpath(zone->size(zone, ptr))) objs[batched++] = (id)ptr;
+        else free(ptr);
+    }
+
+    if (batched) malloc_zone_batch_free(zone, (void **)objs, batched);
+}
+
+// Disposes of objects whose NSObject -dealloc would call object_dispose().
+static void
+disposeInstancesBatch(id *objs, unsigned count)
+{
+    unsigned locked = 0;
+    for (unsigned i = 0; i < count; i++) {
+        id obj = objs[i];
+        // Same order as objc_destructInstance().
+        if (obj->hasCxxDtor()) object_cxxDestruct(obj);
+        if (obj->hasAssociatedObjects()) {
+            _object_remove_assocations(obj, /*deallocating*/true);
+        }
+        // Objects that need the side table go to the front.
+        if (obj->hasSideTableEntries()) {
+            objs[i] = objs[locked];
+            objs[locked++] = obj;
+        }
+    }
+
+    // Clear all objects of one stripe, then move them out of the way
+    // to the back of the locked range.
+    unsigned remaining = locked;
+    while (remaining) {
+        SideTable& table = SideTables()[objs[0]];
+        table.lock();
+        for (unsigned i = 0; i < remaining; ) {
+            id obj = objs[i];
+            if (&SideTables()[obj] == &table) {
+                obj->clearDeallocating_nolock(table);
+                objs[i] = objs[--remaining];
+                objs[remaining] = obj;
+            } else {
+                i++;
+            }
+        }
+        table.unlock();
+    }
+
+    for (unsigned i = 0; i < count; i++) {
+        objc::freeInstanceMemory(objs[i]);
+    }
+}
+
+void
+objc_releaseObjects(id *objects, unsigned count)
+{
+    id fast[RELEASE_BATCH_COUNT];
+    id slow[RELEASE_BATCH_COUNT];
+
+    unsigned i = 0;
+    while (i < count) {
+        unsigned fastCount = 0;
+        unsigned slowCount = 0;
+
+        for ( ; i < count  &&  fastCount < RELEASE_BATCH_COUNT  &&
+                slowCount < RELEASE_BATCH_COUNT; i++)
+        {
+            id obj = objects[i];
+            if (obj->isTaggedPointerOrNil()) continue;
+
+            Class cls = obj->ISA();
+            if (slowpath(cls->hasCustomRR())) {
+                obj->release();
+                continue;
+            }
+            if (!obj->rootReleaseShouldDealloc()) continue;
+
+            if (slowpath(cls->hasCustomDealloc())) {
+                ((void(*)(objc_object *, SEL))objc_msgSend)(obj, @selector(dealloc));
+            } else if (fastpath(obj->canFreeWithoutDestruct())) {
+                fast[fastCount++] = obj;
+            } else {
+                // Counted as rootDealloc() would count it.
+                if (slowpath(ProfileRC)) objc::rcProfileDealloc(obj);
+                slow[slowCount++] = obj;
+            }
+        }
+
+        if (slowCount) disposeInstancesBatch(slow, slowCount);
+        if (fastCount) freeInstancesBatch(fast, fastCount);
+    }
+}
+
+
 // OBJC2
 #else
 // not OBJC2
@@ -1906,6 +2985,14 @@ id objc_retain(id obj) { return [obj retain]; }
 void objc_release(id obj) { [obj release]; }
 id objc_autorelease(id obj) { return [obj autorelease]; }
 
+void
+objc_releaseObjects(id *objects, unsigned count)
+{
+    for (unsigned i = 0; i < count; i++) {
+        [objects[i] release];
+    }
+}
+
 
 #endif
 
@@ -1962,6 +3049,11 @@ _objc_rootRetainCount(id obj)
 {
     ASSERT(obj);
 
+#if __OBJC2__
+    if (slowpath(CoalesceRetainRelease)) {
+        return obj->rootRetainCount() - objc::pendingReleaseCount(obj);
+    }
+#endif
     return obj->rootRetainCount();
 }
 
@@ -2027,6 +3119,31 @@ objc_allocWithZone(Class cls)
     return callAlloc(cls, true/*checkNil*/, true/*allocWithZone*/);
 }
 
+// Calls [cls alloc] up to count times.
+// Batches the allocations once cls is known to use the default +alloc.
+unsigned
+objc_allocInstances(Class cls, id *results, unsigned count)
+{
+    unsigned n = 0;
+    if (slowpath(!cls)) return 0;
+
+    while (n < count) {
+#if __OBJC2__
+        // The first +alloc below initializes cls.
+        if (fastpath(!cls->ISA()->hasCustomAWZ())) {
+            n += _class_createInstancesFromZone(cls, 0, nil,
+                                                results + n, count - n,
+                                                OBJECT_CONSTRUCT_DEFAULT_ALLOC);
+            break;
+        }
+#endif
+        id obj = ((id(*)(id, SEL))objc_msgSend)(cls, @selector(alloc));
+        if (!obj) break;
+        results[n++] = obj;
+    }
+    return n;
+}
+
 // Calls [[cls alloc] init].
 id
 objc_alloc_init(Class cls)
@@ -2150,6 +3267,9 @@ _objc_rootHash(id obj)
 void *
 objc_autoreleasePoolPush(void)
 {
+#if __OBJC2__
+    if (slowpath(CoalesceRetainRelease)) objc::pendingReleaseFlush();
+#endif
     return AutoreleasePoolPage::push();
 }
 
@@ -2158,6 +3278,12 @@ void
 objc_autoreleasePoolPop(void *ctxt)
 {
     AutoreleasePoolPage::pop(ctxt);
+#if __OBJC2__
+    if (slowpath(CoalesceRetainRelease)) objc::pendingReleaseFlush();
+#endif
+#if ISA_HAS_BIASED_RC_BIT
+    if (slowpath(DeferredRC)) objc::rcBiasFlush();
+#endif
 }
 
 
@@ -2266,6 +3392,20 @@ void arr_init(void)
     AutoreleasePoolPage::init();
     SideTablesMap.init();
     _objc_associations_init();
+#if SUPPORT_SEGREGATED_ALLOC
+    if (SegregatedAlloc) objc::slabInit();
+#endif
+#if SUPPORT_NONPOINTER_ISA
+    if (OutOfLineRC) objc::rcCounterInit();
+#endif
+    if (ProfileRC) objc::rcProfileInit();
+    if (LockFreeProperties) objc::propertyHazardsInit();
+#if ISA_HAS_BIASED_RC_BIT
+    if (DeferredRC) objc::rcBiasInit();
+#endif
+#if __OBJC2__
+    if (CoalesceRetainRelease) objc::pendingReleaseInit();
+#endif
 }
 
 
@@ -48,6 +48,8 @@
     // shiftcls must occupy the same bits that a real class pointer would
     // bits + RC_ONE is equivalent to extra_rc + 1
     // RC_HALF is the high bit of extra_rc (i.e. half of its range)
+    // biased_rc means the allocating thread keeps some of the retain 
+    // count in thread-local storage (OBJC_DEFERRED_RC, see NSObject.mm)
 
     // future expansion:
     // uintptr_t fast_rr : 1;     // no r/r overrides
@@ -62,6 +64,7 @@
 #     define ISA_MAGIC_MASK  0x0000000000000001ULL
 #     define ISA_MAGIC_VALUE 0x0000000000000001ULL
 #     define ISA_HAS_CXX_DTOR_BIT 0
+#     define ISA_HAS_BIASED_RC_BIT 0
 #     define ISA_BITFIELD                                                      \
         uintptr_t nonpointer        : 1;                                       \
         uintptr_t has_assoc         : 1;                                       \
@@ -76,6 +79,7 @@
 #     define ISA_MAGIC_MASK  0x000003f000000001ULL
 #     define ISA_MAGIC_VALUE 0x000001a000000001ULL
 #     define ISA_HAS_CXX_DTOR_BIT 1
+#     define ISA_HAS_BIASED_RC_BIT 1
 #     define ISA_BITFIELD                                                      \
         uintptr_t nonpointer        : 1;                                       \
         uintptr_t has_assoc         : 1;                                       \
@@ -83,7 +87,7 @@
         uintptr_t shiftcls          : 33; /*MACH_VM_MAX_ADDRESS 0x1000000000*/ \
         uintptr_t magic             : 6;                                       \
         uintptr_t weakly_referenced : 1;                                       \
-        uintptr_t unused            : 1;                                       \
+        uintptr_t biased_rc         : 1;                                       \
         uintptr_t has_sidetable_rc  : 1;                                       \
         uintptr_t extra_rc          : 19
 #     define RC_ONE   (1ULL<<45)
@@ -95,6 +99,7 @@
 #   define ISA_MAGIC_MASK  0x001f800000000001ULL
 #   define ISA_MAGIC_VALUE 0x001d800000000001ULL
 #   define ISA_HAS_CXX_DTOR_BIT 1
+#   define ISA_HAS_BIASED_RC_BIT 1
 #   define ISA_BITFIELD                                                        \
       uintptr_t nonpointer        : 1;                                         \
       uintptr_t has_assoc         : 1;                                         \
@@ -102,7 +107,7 @@
       uintptr_t shiftcls          : 44; /*MACH_VM_MAX_ADDRESS 0x7fffffe00000*/ \
       uintptr_t magic             : 6;                                         \
       uintptr_t weakly_referenced : 1;                                         \
-      uintptr_t unused            : 1;                                         \
+      uintptr_t biased_rc         : 1;                                         \
       uintptr_t has_sidetable_rc  : 1;                                         \
       uintptr_t extra_rc          : 8
 #   define RC_ONE   (1ULL<<56)
@@ -130,6 +135,7 @@
 #   define ISA_INDEX_MAGIC_MASK  0x001E0001
 #   define ISA_INDEX_MAGIC_VALUE 0x001C0001
 #   define ISA_HAS_CXX_DTOR_BIT  1
+#   define ISA_HAS_BIASED_RC_BIT 1
 #   define ISA_BITFIELD                         \
       uintptr_t nonpointer        : 1;          \
       uintptr_t has_assoc         : 1;          \
@@ -137,7 +143,7 @@
       uintptr_t magic             : 4;          \
       uintptr_t has_cxx_dtor      : 1;          \
       uintptr_t weakly_referenced : 1;          \
-      uintptr_t unused            : 1;          \
+      uintptr_t biased_rc         : 1;          \
       uintptr_t has_sidetable_rc  : 1;          \
       uintptr_t extra_rc          : 7
 #   define RC_ONE   (1ULL<<25)
@@ -151,5 +157,10 @@
 #endif
 
 
+#ifndef ISA_HAS_BIASED_RC_BIT
+#   define ISA_HAS_BIASED_RC_BIT 0
+#endif
+
+
 // _OBJC_ISA_H_
 #endif
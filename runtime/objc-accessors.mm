@@ -23,6 +23,7 @@
 
 #include <string.h>
 #include <stddef.h>
+#include <sched.h>
 
 #include <libkern/OSAtomic.h>
 
@@ -45,6 +46,166 @@ StripedMap<spinlock_t> CppObjectLocks;
 
 #define MUTABLE_COPY 2
 
+
+/***********************************************************************
+* Lock-free atomic properties.
+* With OBJC_LOCK_FREE_PROPERTIES, atomic getters and setters exchange 
+* the slot with atomic operations instead of taking a PropertyLocks 
+* spinlock. A getter publishes the value it is about to retain in its 
+* thread's hazard record, then checks that the slot still holds that 
+* value. A setter that swapped a 
+* value out waits until no hazard record holds it before releasing it,
+* so a getter never retains an object that the setter's release freed.
+* A getter's retain may call a custom -retain that runs other getters,
+* so each record holds a small stack of hazards. A thread that nests 
+* deeper takes more records.
+* Hazard records are never freed. A thread's records are reused by 
+* another thread after it exits.
+* A setter may spin for as long as a getter on another thread holds 
+* the old value, so a low priority getter can delay a high priority 
+* setter. This is off by default for that reason.
+**********************************************************************/
+namespace objc {
+
+static constexpr unsigned PropertyHazardDepth = 4;
+
+struct alignas(CacheLineSize) property_hazard_t {
+    std::atomic<id> values[PropertyHazardDepth];
+    std::atomic<bool> active;
+    // Owning thread only.
+    unsigned depth;
+    property_hazard_t *overflow;
+    property_hazard_t *next;
+};
+
+static std::atomic<property_hazard_t *> PropertyHazards;
+
+static void propertyHazardRelinquish(void *arg)
+{
+    auto *hazard = (property_hazard_t *)arg;
+    while (hazard) {
+        auto *overflow = hazard->overflow;
+        for (auto& value : hazard->values) {
+            value.store(nil, std::memory_order_relaxed);
+        }
+        hazard->depth = 0;
+        hazard->overflow = nil;
+        hazard->active.store(false, std::memory_order_release);
+        hazard = overflow;
+    }
+}
+
+static property_hazard_t *propertyHazardTake()
+{
+    auto *hazard = PropertyHazards.load(std::memory_order_acquire);
+    for ( ; hazard; hazard = hazard->next) {
+        bool active = false;
+        if (!hazard->active.load(std::memory_order_relaxed)  &&
+            hazard->active.compare_exchange_strong(active, true,
+                                                   std::memory_order_acquire))
+        {
+            break;
+        }
+    }
+
+    if (!hazard) {
+        hazard = new property_hazard_t{};
+        hazard->active.store(true, std::memory_order_relaxed);
+        auto *head = PropertyHazards.load(std::memory_order_relaxed);
+        do {
+            hazard->next = head;
+        } while (!PropertyHazards.compare_exchange_weak(head, hazard,
+                                                        std::memory_order_release,
+                                                        std::memory_order_relaxed));
+    }
+    return hazard;
+}
+
+// Returns the record holding this thread's next free hazard.
+static ALWAYS_INLINE property_hazard_t *propertyHazard()
+{
+    auto *hazard = (property_hazard_t *)tls_get_direct(PROPERTY_HAZARD_KEY);
+    if (slowpath(!hazard)) {
+        hazard = propertyHazardTake();
+        tls_set_direct(PROPERTY_HAZARD_KEY, hazard);
+    }
+    while (slowpath(hazard->depth == PropertyHazardDepth)) {
+        if (!hazard->overflow) hazard->overflow = propertyHazardTake();
+        hazard = hazard->overflow;
+    }
+    return hazard;
+}
+
+static bool propertyHazardsContain(id value)
+{
+    auto *hazard = PropertyHazards.load(std::memory_order_acquire);
+    for ( ; hazard; hazard = hazard->next) {
+        for (auto& published : hazard->values) {
+            if (published.load(std::memory_order_seq_cst) == value) return true;
+        }
+    }
+    return false;
+}
+
+void propertyHazardsInit(void)
+{
+    int r __unused = pthread_key_init_np(PROPERTY_HAZARD_KEY,
+                                         &propertyHazardRelinquish);
+    ASSERT(r == 0);
+}
+
+// The threads that were between publishing a hazard and clearing it 
+// do not exist in the child.
+void propertyHazardsForkChild(void)
+{
+    auto *hazard = PropertyHazards.load(std::memory_order_relaxed);
+    for ( ; hazard; hazard = hazard->next) {
+        for (auto& value : hazard->values) {
+            value.store(nil, std::memory_order_relaxed);
+        }
+    }
+}
+
+}
+
+static id atomicGetProperty(id *slot)
+{
+    auto *hazard = objc::propertyHazard();
+    auto& published = hazard->values[hazard->depth++];
+    auto *atomicSlot = (std::atomic<id> *)slot;
+
+    id value = atomicSlot->load(std::memory_order_acquire);
+    while (value) {
+        published.store(value, std::memory_order_seq_cst);
+        id current = atomicSlot->load(std::memory_order_seq_cst);
+        if (fastpath(current == value)) {
+            // No setter can release value until the hazard is cleared.
+            // A custom -retain that runs getters uses the next hazards.
+            value = objc_retain(value);
+            break;
+        }
+        value = current;
+    }
+    published.store(nil, std::memory_order_release);
+    hazard->depth--;
+    return value;
+}
+
+static id atomicExchangeProperty(id *slot, id newValue)
+{
+    auto *atomicSlot = (std::atomic<id> *)slot;
+    id oldValue = atomicSlot->exchange(newValue, std::memory_order_seq_cst);
+
+    // Wait for getters that may have read oldValue to retain it.
+    if (oldValue  &&  !oldValue->isTaggedPointer()) {
+        for (unsigned spins = 0; objc::propertyHazardsContain(oldValue); spins++) {
+            if (spins > 100) sched_yield();
+        }
+    }
+    return oldValue;
+}
+
+
 id objc_getProperty(id self, SEL _cmd, ptrdiff_t offset, BOOL atomic) {
     if (offset == 0) {
         return object_getClass(self);
@@ -53,7 +214,11 @@ id objc_getProperty(id self, SEL _cmd, ptrdiff_t offset, BOOL atomic) {
     // Retain release world
     id *slot = (id*) ((char*)self + offset);
     if (!atomic) return *slot;
-        
+
+    if (LockFreeProperties) {
+        return objc_autoreleaseReturnValue(atomicGetProperty(slot));
+    }
+
     // Atomic retain release world
     spinlock_t& slotlock = PropertyLocks[slot];
     slotlock.lock();
@@ -89,6 +254,8 @@ static inline void reallySetProperty(id self, SEL _cmd, id newValue, ptrdiff_t o
     if (!atomic) {
         oldValue = *slot;
         *slot = newValue;
+    } else if (LockFreeProperties) {
+        oldValue = atomicExchangeProperty(slot, newValue);
     } else {
         spinlock_t& slotlock = PropertyLocks[slot];
         slotlock.lock();
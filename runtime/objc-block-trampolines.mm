@@ -327,14 +327,122 @@ struct TrampolineBlockPageGroup
 
 };
 
-static TrampolineBlockPageGroup *HeadPageGroup;
-
 #pragma mark Utility Functions
 
 #if !__OBJC2__
 #define runtimeLock classLock
 #endif
 
+static TrampolineBlockPageGroup *HeadPageGroup;
+static TrampolineBlockPageGroup *LastPageGroup;
+
+
+// Bookkeeping for a page group that does not fit in its data page.
+// The data page has no room beyond the fields above, because they 
+// share space with the trampoline header code.
+struct TrampolinePageGroupInfo
+{
+    TrampolineBlockPageGroup *pageGroup;
+    bool onAvailableList;  // in HeadPageGroup's nextAvailablePage list
+
+    // Bit i is set while slot i holds a block.
+    std::atomic<uint64_t> allocated[(TRAMPOLINE_PAGE_SIZE / SLOT_SIZE + 63) / 64];
+
+    TrampolinePageGroupInfo(TrampolineBlockPageGroup *group)
+        : pageGroup(group), onAvailableList(false), allocated{}
+    { }
+
+    bool isAllocated(uintptr_t index) {
+        return allocated[index / 64].load(std::memory_order_acquire) & 
+            (1ULL << (index % 64));
+    }
+
+    void setAllocated(uintptr_t index) {
+        allocated[index / 64].fetch_or(1ULL << (index % 64), 
+                                       std::memory_order_release);
+    }
+
+    // Returns false if the slot was not allocated.
+    bool clearAllocated(uintptr_t index) {
+        uint64_t bit = 1ULL << (index % 64);
+        return allocated[index / 64].fetch_and(~bit, std::memory_order_acq_rel) & bit;
+    }
+};
+
+
+// Maps addresses in page groups to their TrampolinePageGroupInfo.
+// A three-level radix tree indexed by PAGE_MIN_SIZE page number. 
+// The page number's bits are split about evenly between the levels, 
+// so the tree fits both 48-bit and 32-bit address spaces.
+// Page groups are aligned to at least PAGE_MIN_SIZE, so no page is 
+// shared by two groups. Nodes are never freed, so readers need no lock.
+// Locking: writers must hold runtimeLock.
+class TrampolinePageMap {
+#if __LP64__
+    static constexpr unsigned AddressBits = 48;
+#else
+    static constexpr unsigned AddressBits = 32;
+#endif
+    static constexpr unsigned PageShift = PAGE_MIN_SHIFT;
+    static constexpr unsigned PageBits = AddressBits - PageShift;
+    static constexpr unsigned LeafBits = (PageBits + 2) / 3;
+    static constexpr unsigned MidBits = (PageBits - LeafBits + 1) / 2;
+    static constexpr unsigned RootBits = PageBits - LeafBits - MidBits;
+    static_assert(PageBits < sizeof(uintptr_t) * 8, 
+                  "page numbers must be shiftable by PageBits");
+
+    struct Leaf {
+        std::atomic<TrampolinePageGroupInfo *> entries[1 << LeafBits];
+    };
+    struct Mid {
+        std::atomic<Leaf *> leaves[1 << MidBits];
+    };
+
+    std::atomic<Mid *> root[1 << RootBits];
+
+    template <typename T>
+    static T *getOrCreate(std::atomic<T *>& slot) {
+        T *node = slot.load(std::memory_order_relaxed);
+        if (!node) {
+            node = (T *)calloc(1, sizeof(T));
+            slot.store(node, std::memory_order_release);
+        }
+        return node;
+    }
+
+public:
+    TrampolinePageGroupInfo *get(uintptr_t address) {
+        uintptr_t page = address >> PageShift;
+        if (page >> PageBits) return nil;
+
+        Mid *mid = root[page >> (MidBits + LeafBits)]
+            .load(std::memory_order_acquire);
+        if (!mid) return nil;
+        Leaf *leaf = mid->leaves[(page >> LeafBits) & ((1 << MidBits) - 1)]
+            .load(std::memory_order_acquire);
+        if (!leaf) return nil;
+        return leaf->entries[page & ((1 << LeafBits) - 1)]
+            .load(std::memory_order_acquire);
+    }
+
+    void set(uintptr_t start, uintptr_t end, TrampolinePageGroupInfo *info) {
+        runtimeLock.assertLocked();
+
+        for (uintptr_t address = start; address < end; address += PAGE_MIN_SIZE) {
+            uintptr_t page = address >> PageShift;
+            if (page >> PageBits) {
+                _objc_fatal("trampoline address %p out of range", (void *)address);
+            }
+            Mid *mid = getOrCreate(root[page >> (MidBits + LeafBits)]);
+            Leaf *leaf = getOrCreate(mid->leaves[(page >> LeafBits) & ((1 << MidBits) - 1)]);
+            leaf->entries[page & ((1 << LeafBits) - 1)]
+                .store(info, std::memory_order_release);
+        }
+    }
+};
+
+static TrampolinePageMap TrampolinePages;
+
 #pragma mark Trampoline Management Functions
 static TrampolineBlockPageGroup *_allocateTrampolinesAndData()
 {
@@ -387,17 +495,19 @@ static TrampolineBlockPageGroup *_allocateTrampolinesAndData()
     }
 
     auto *pageGroup = new ((void*)dataAddress) TrampolineBlockPageGroup;
+    auto *info = new TrampolinePageGroupInfo(pageGroup);
+    TrampolinePages.set(dataAddress, 
+                        pageGroup->trampolinesForMode(ArgumentModeCount), 
+                        info);
     
     if (HeadPageGroup) {
-        TrampolineBlockPageGroup *lastPageGroup = HeadPageGroup;
-        while(lastPageGroup->nextPageGroup) {
-            lastPageGroup = lastPageGroup->nextPageGroup;
-        }
-        lastPageGroup->nextPageGroup = pageGroup;
+        LastPageGroup->nextPageGroup = pageGroup;
         HeadPageGroup->nextAvailablePage = pageGroup;
+        info->onAvailableList = true;
     } else {
         HeadPageGroup = pageGroup;
     }
+    LastPageGroup = pageGroup;
     
     return pageGroup;
 }
@@ -420,28 +530,23 @@ getOrAllocatePageGroupWithNextAvailable()
     return _allocateTrampolinesAndData(); // tack on a new one
 }
 
-static TrampolineBlockPageGroup *
-pageAndIndexContainingIMP(IMP anImp, uintptr_t *outIndex) 
+static TrampolinePageGroupInfo *
+pageInfoAndIndexContainingIMP(IMP anImp, uintptr_t *outIndex) 
 {
-    runtimeLock.assertLocked();
-
     // Authenticate as a function pointer, returning an un-signed address.
     uintptr_t trampAddress =
             (uintptr_t)ptrauth_auth_data((const char *)anImp,
                                          ptrauth_key_function_pointer, 0);
 
-    for (TrampolineBlockPageGroup *pageGroup = HeadPageGroup; 
-         pageGroup;
-         pageGroup = pageGroup->nextPageGroup)
-    {
-        uintptr_t index = pageGroup->indexForTrampoline(trampAddress);
-        if (index) {
-            if (outIndex) *outIndex = index;
-            return pageGroup;
-        }
-    }
-    
-    return nil;
+    TrampolinePageGroupInfo *info = TrampolinePages.get(trampAddress);
+    if (!info) return nil;
+
+    // The address may be in the group's data or header pages.
+    uintptr_t index = info->pageGroup->indexForTrampoline(trampAddress);
+    if (!index) return nil;
+
+    if (outIndex) *outIndex = index;
+    return info;
 }
 
 
@@ -486,9 +591,9 @@ _imp_implementationWithBlock_init(void)
 }
 
 
-// `block` must already have been copied 
-IMP 
-_imp_implementationWithBlockNoCopy(id block)
+// Takes a free slot from the shared free lists.
+static TrampolinePageGroupInfo *
+allocateSlot_nolock(uintptr_t *outIndex)
 {
     runtimeLock.assertLocked();
 
@@ -506,21 +611,128 @@ _imp_implementationWithBlockNoCopy(id block)
         nextAvailableIndex = index + 1;
     }
     pageGroup->nextAvailable = nextAvailableIndex;
-    if (nextAvailableIndex == pageGroup->endIndex()) {
+
+    TrampolinePageGroupInfo *info = TrampolinePages.get((uintptr_t)pageGroup);
+    if (nextAvailableIndex == pageGroup->endIndex()  &&  
+        pageGroup != HeadPageGroup)
+    {
         // PageGroup is now full (free list or wilderness exhausted)
         // Remove from available page linked list
-        TrampolineBlockPageGroup *iterator = HeadPageGroup;
-        while(iterator && (iterator->nextAvailablePage != pageGroup)) {
-            iterator = iterator->nextAvailablePage;
-        }
-        if (iterator) {
-            iterator->nextAvailablePage = pageGroup->nextAvailablePage;
-            pageGroup->nextAvailablePage = nil;
-        }
+        // The head page is never on the list. Any other filling page 
+        // is the first available page, right after the head.
+        ASSERT(info->onAvailableList);
+        ASSERT(HeadPageGroup->nextAvailablePage == pageGroup);
+        HeadPageGroup->nextAvailablePage = pageGroup->nextAvailablePage;
+        pageGroup->nextAvailablePage = nil;
+        info->onAvailableList = false;
     }
-    
-    payload->block = block;
-    return pageGroup->trampoline(argumentModeForBlock(block), index);
+
+    *outIndex = index;
+    return info;
+}
+
+// Returns a slot to the shared free lists.
+static void
+freeSlot_nolock(TrampolinePageGroupInfo *info, uintptr_t index)
+{
+    runtimeLock.assertLocked();
+
+    TrampolineBlockPageGroup *pageGroup = info->pageGroup;
+    TrampolineBlockPageGroup::Payload *payload = pageGroup->payload(index);
+    payload->nextAvailable = pageGroup->nextAvailable;
+    pageGroup->nextAvailable = index;
+        
+    // make sure this page is on available linked list
+    // The head page is always checked first and is never on it.
+    if (pageGroup != HeadPageGroup  &&  !info->onAvailableList) {
+        pageGroup->nextAvailablePage = HeadPageGroup->nextAvailablePage;
+        HeadPageGroup->nextAvailablePage = pageGroup;
+        info->onAvailableList = true;
+    }
+}
+
+// Fills a slot with a block and returns its trampoline.
+static IMP
+useSlot(TrampolinePageGroupInfo *info, uintptr_t index, id block)
+{
+    info->pageGroup->payload(index)->block = block;
+    // Publishes the block to lock-free imp_getBlock().
+    info->setAllocated(index);
+    return info->pageGroup->trampoline(argumentModeForBlock(block), index);
+}
+
+
+#pragma mark Per-Thread Slot Caches
+
+// Free slots owned by one thread, so that most calls to 
+// imp_implementationWithBlock() and imp_removeBlock() take no lock.
+// The cache is refilled and drained in batches under runtimeLock.
+// Slots cached by other threads are lost in the child of fork().
+static constexpr unsigned TrampolineCacheSize = 64;
+static constexpr unsigned TrampolineCacheBatch = TrampolineCacheSize / 2;
+
+struct TrampolineCache {
+    unsigned count;
+    struct {
+        TrampolinePageGroupInfo *info;
+        uintptr_t index;
+    } slots[TrampolineCacheSize];
+};
+
+static TrampolineCache *
+fetchTrampolineCache()
+{
+    _objc_pthread_data *data = _objc_fetch_pthread_data(true);
+    if (!data->trampolineCache) {
+        data->trampolineCache = 
+            (TrampolineCache *)calloc(1, sizeof(TrampolineCache));
+    }
+    return data->trampolineCache;
+}
+
+static void
+refillTrampolineCache(TrampolineCache *cache)
+{
+    mutex_locker_t lock(runtimeLock);
+    while (cache->count < TrampolineCacheBatch) {
+        auto& slot = cache->slots[cache->count++];
+        slot.info = allocateSlot_nolock(&slot.index);
+    }
+}
+
+static void
+drainTrampolineCache(TrampolineCache *cache, unsigned keep)
+{
+    mutex_locker_t lock(runtimeLock);
+    while (cache->count > keep) {
+        auto& slot = cache->slots[--cache->count];
+        freeSlot_nolock(slot.info, slot.index);
+    }
+}
+
+/***********************************************************************
+* _destroyTrampolineCache
+* Returns a dying thread's cached slots to the shared free lists.
+* Called from _objc_pthread_destroyspecific().
+**********************************************************************/
+void
+_destroyTrampolineCache(struct TrampolineCache *cache)
+{
+    if (!cache) return;
+    drainTrampolineCache(cache, 0);
+    free(cache);
+}
+
+
+// `block` must already have been copied 
+IMP 
+_imp_implementationWithBlockNoCopy(id block)
+{
+    runtimeLock.assertLocked();
+
+    uintptr_t index;
+    TrampolinePageGroupInfo *info = allocateSlot_nolock(&index);
+    return useSlot(info, index, block);
 }
 
 
@@ -535,79 +747,52 @@ IMP imp_implementationWithBlock(id block)
     // because it calls dlopen().
     Trampolines.Initialize();
     
-    mutex_locker_t lock(runtimeLock);
+    TrampolineCache *cache = fetchTrampolineCache();
+    if (cache->count == 0) refillTrampolineCache(cache);
 
-    return _imp_implementationWithBlockNoCopy(block);
+    auto& slot = cache->slots[--cache->count];
+    return useSlot(slot.info, slot.index, block);
 }
 
 
 id imp_getBlock(IMP anImp) {
     uintptr_t index;
-    TrampolineBlockPageGroup *pageGroup;
+    TrampolinePageGroupInfo *info;
     
     if (!anImp) return nil;
     
-    mutex_locker_t lock(runtimeLock);
-    
-    pageGroup = pageAndIndexContainingIMP(anImp, &index);
+    info = pageInfoAndIndexContainingIMP(anImp, &index);
     
-    if (!pageGroup) {
+    if (!info  ||  !info->isAllocated(index)) {
         return nil;
     }
 
-    TrampolineBlockPageGroup::Payload *payload = pageGroup->payload(index);
-    
-    if (payload->nextAvailable <= TrampolineBlockPageGroup::endIndex()) {
-        // unallocated
-        return nil;
-    }
-    
-    return payload->block;
+    return info->pageGroup->payload(index)->block;
 }
 
 BOOL imp_removeBlock(IMP anImp) {
     
     if (!anImp) return NO;
 
-    id block;
-    
-    {
-        mutex_locker_t lock(runtimeLock);
-    
-        uintptr_t index;
-        TrampolineBlockPageGroup *pageGroup =
-            pageAndIndexContainingIMP(anImp, &index);
-        
-        if (!pageGroup) {
-            return NO;
-        }
-        
-        TrampolineBlockPageGroup::Payload *payload = pageGroup->payload(index);
-        block = payload->block;
-        // block is released below, outside the lock
-        
-        payload->nextAvailable = pageGroup->nextAvailable;
-        pageGroup->nextAvailable = index;
-        
-        // make sure this page is on available linked list
-        TrampolineBlockPageGroup *pageGroupIterator = HeadPageGroup;
+    uintptr_t index;
+    TrampolinePageGroupInfo *info = pageInfoAndIndexContainingIMP(anImp, &index);
         
-        // see if page is the next available page for any existing pages
-        while (pageGroupIterator->nextAvailablePage && 
-               pageGroupIterator->nextAvailablePage != pageGroup)
-        {
-            pageGroupIterator = pageGroupIterator->nextAvailablePage;
-        }
+    // Only one caller can clear the bit, even if several race.
+    if (!info  ||  !info->clearAllocated(index)) {
+        return NO;
+    }
         
-        if (! pageGroupIterator->nextAvailablePage) {
-            // if iteration stopped because nextAvail was nil
-            // add to end of list.
-            pageGroupIterator->nextAvailablePage = pageGroup;
-            pageGroup->nextAvailablePage = nil;
-        }
+    id block = info->pageGroup->payload(index)->block;
+
+    TrampolineCache *cache = fetchTrampolineCache();
+    if (cache->count == TrampolineCacheSize) {
+        drainTrampolineCache(cache, TrampolineCacheBatch);
     }
+    auto& slot = cache->slots[cache->count++];
+    slot.info = info;
+    slot.index = index;
 
-    // do this AFTER dropping the lock
+    // do this AFTER returning the slot, outside any lock
     Block_release(block);
     return YES;
 }
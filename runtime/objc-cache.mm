@@ -66,6 +66,7 @@
  * Cache readers/writers (hold cacheUpdateLock during access; not PC-checked)
  * cache_t::copyCacheNolock    (caller must hold the lock)
  * cache_t::eraseNolock        (caller must hold the lock)
+ * cache_t::eraseSelectorsNolock (caller must hold the lock)
  * cache_t::collectNolock      (caller must hold the lock)
  * cache_t::insert             (acquires lock)
  * cache_t::destroy            (acquires lock)
@@ -968,6 +969,77 @@ void cache_t::eraseNolock(const char *func)
 }
 
 
+// Remove the given selectors from this cache, keeping all other entries.
+// sels must be sorted by address.
+// Buckets are never cleared in place: a concurrent objc_msgSend that has
+// already matched a bucket's sel may still be about to load its imp.
+// Instead the surviving entries are copied into new buckets of the same
+// capacity and the old buckets go to the garbage list, as in eraseNolock.
+void cache_t::eraseSelectorsNolock(const SEL *sels, uint32_t count,
+                                   const char *func)
+{
+#if CONFIG_USE_CACHE_LOCK
+    cacheUpdateLock.assertLocked();
+#else
+    runtimeLock.assertLocked();
+#endif
+
+    if (isConstantOptimizedCache()) {
+        eraseNolock(func);
+        return;
+    }
+    if (occupied() == 0  ||  count == 0) return;
+
+    auto shouldErase = [&](SEL sel) {
+        return std::binary_search(sels, sels + count, sel);
+    };
+
+    bucket_t *oldBuckets = buckets();
+    mask_t capacity = this->capacity();
+    // The end marker, if any, is the last bucket and is never copied.
+    mask_t scanCount = capacity - CACHE_END_MARKER;
+    mask_t kept = 0;
+    bool found = false;
+    for (mask_t i = 0; i < scanCount; i++) {
+        SEL sel = oldBuckets[i].sel();
+        if (!sel) continue;
+        if (shouldErase(sel)) found = true;
+        else kept++;
+    }
+    if (!found) return;
+    if (kept == 0) {
+        eraseNolock(func);
+        return;
+    }
+
+    Class cls = this->cls();
+    bucket_t *newBuckets = allocateBuckets(capacity);
+    mask_t m = capacity - 1;
+    for (mask_t i = 0; i < scanCount; i++) {
+        SEL sel = oldBuckets[i].sel();
+        if (!sel  ||  shouldErase(sel)) continue;
+
+        mask_t j = cache_hash(sel, m);
+        while (newBuckets[j].sel() != 0) j = cache_next(j, m);
+        newBuckets[j].set<NotAtomic, Encoded>(newBuckets, sel,
+                                              oldBuckets[i].imp(oldBuckets, cls),
+                                              cls);
+    }
+
+    if (PrintCaches) {
+        _objc_inform("CACHES: %sclass %s: erased %u of %u entries (from %s)",
+                     cls->isMetaClass() ? "meta" : "", cls->nameForLogging(),
+                     (unsigned)(occupied() - kept), (unsigned)occupied(), func);
+    }
+
+    // Make the copied buckets visible before the buckets pointer.
+    std::atomic_thread_fence(std::memory_order_release);
+    setBucketsAndMask(newBuckets, m); // also clears occupied
+    _occupied = kept;
+    collect_free(oldBuckets, capacity);
+}
+
+
 void cache_t::destroy()
 {
 #if CONFIG_USE_CACHE_LOCK
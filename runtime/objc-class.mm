@@ -158,6 +158,7 @@
 
 #include "objc-private.h"
 #include "objc-abi.h"
+#include "DenseMapExtras.h"
 #include <objc/message.h>
 #if !TARGET_OS_WIN32
 //#include <os/linker_set.h>
@@ -435,6 +436,7 @@ Ivar object_getInstanceVariable(id obj, const char *name, void **value)
 * Call C++ destructors on obj, starting with cls's 
 *   dtor method (if any) followed by superclasses' dtors (if any), 
 *   stopping at cls's dtor (if any).
+* The dtors are usually found in cls's destructor chain.
 * Uses methodListLock and cacheUpdateLock. The caller must hold neither.
 **********************************************************************/
 static void object_cxxDestructFromClass(id obj, Class cls)
@@ -442,6 +444,21 @@ static void object_cxxDestructFromClass(id obj, Class cls)
     // 函数指针
     void (*dtor)(id);
 
+    if (!cls  ||  !cls->hasCxxDtor()) return;
+
+#if __OBJC2__
+    if (auto *chain = objc::cxxDestructChain(cls)) {
+        for (uint32_t i = 0; i < chain->count; i++) {
+            if (PrintCxxCtors) {
+                _objc_inform("CXX: calling C++ destructors for class %s", 
+                             chain->entries[i].cls->nameForLogging());
+            }
+            (*(void(*)(id))chain->entries[i].imp)(obj);
+        }
+        return;
+    }
+#endif
+
     // Call cls's dtor first, then superclasses's dtors.
 
     for ( ; cls; cls = cls->getSuperclass()) {
@@ -486,6 +503,7 @@ void object_cxxDestruct(id obj)
 *   ctor method (if any) followed by subclasses' ctors (if any), stopping 
 *   at cls's ctor (if any).
 * Does not check cls->hasCxxCtor(). The caller should preflight that.
+* The ctors are usually found in cls's constructor chain.
 * Returns self if construction succeeded.
 * Returns nil if some constructor threw an exception. The exception is 
 *   caught and discarded. Any partial construction is destructed.
@@ -503,6 +521,30 @@ object_cxxConstructFromClass(id obj, Class cls, int flags)
     id (*ctor)(id);
     Class supercls;
 
+#if __OBJC2__
+    if (auto *chain = objc::cxxConstructChain(cls)) {
+        for (uint32_t i = 0; i < chain->count; i++) {
+            Class c = chain->entries[i].cls;
+            if (PrintCxxCtors) {
+                _objc_inform("CXX: calling C++ constructors for class %s", 
+                             c->nameForLogging());
+            }
+            ctor = (id(*)(id))chain->entries[i].imp;
+            if (fastpath((*ctor)(obj))) continue;
+
+            // c's ctor failed. Call superclasses's dtors to clean up.
+            supercls = c->getSuperclass();
+            if (supercls) object_cxxDestructFromClass(obj, supercls);
+            if (flags & OBJECT_CONSTRUCT_FREE_ONFAILURE) objc::freeInstanceMemory(obj);
+            if (flags & OBJECT_CONSTRUCT_CALL_BADALLOC) {
+                return _objc_callBadAllocHandler(c);
+            }
+            return nil;
+        }
+        return obj;
+    }
+#endif
+
     supercls = cls->getSuperclass();
 
     // Call superclasses' ctors first, if any.
@@ -527,7 +569,7 @@ object_cxxConstructFromClass(id obj, Class cls, int flags)
     // This class's ctor was called and failed.
     // Call superclasses's dtors to clean up.
     if (supercls) object_cxxDestructFromClass(obj, supercls);
-    if (flags & OBJECT_CONSTRUCT_FREE_ONFAILURE) free(obj);
+    if (flags & OBJECT_CONSTRUCT_FREE_ONFAILURE) objc::freeInstanceMemory(obj);
     if (flags & OBJECT_CONSTRUCT_CALL_BADALLOC) {
         return _objc_callBadAllocHandler(cls);
     }
@@ -535,6 +577,63 @@ object_cxxConstructFromClass(id obj, Class cls, int flags)
 }
 
 
+/***********************************************************************
+* object_cxxConstructBatchFromClass.
+* object_cxxConstructFromClass() for count objects of class cls, 
+*   looking up the constructors once for the whole batch.
+* Objects whose construction fails are destructed and freed, and the 
+*   others are moved to the front of objs.
+* Returns the number of objects constructed.
+* Uses methodListLock and cacheUpdateLock. The caller must hold neither.
+**********************************************************************/
+unsigned
+object_cxxConstructBatchFromClass(id *objs, unsigned count, Class cls)
+{
+    ASSERT(cls->hasCxxCtor());
+
+    const objc::cxx_chain_t *chain = nil;
+#if __OBJC2__
+    chain = objc::cxxConstructChain(cls);
+#endif
+    if (slowpath(!chain)) {
+        unsigned survivors = 0;
+        for (unsigned i = 0; i < count; i++) {
+            id obj = object_cxxConstructFromClass(objs[i], cls,
+                                                  OBJECT_CONSTRUCT_FREE_ONFAILURE);
+            if (obj) objs[survivors++] = obj;
+        }
+        return survivors;
+    }
+
+    if (PrintCxxCtors) {
+        for (uint32_t k = 0; k < chain->count; k++) {
+            _objc_inform("CXX: calling C++ constructors for class %s "
+                         "(%u objects)", chain->entries[k].cls->nameForLogging(), 
+                         count);
+        }
+    }
+
+    unsigned survivors = 0;
+    for (unsigned i = 0; i < count; i++) {
+        id obj = objs[i];
+        bool ok = true;
+        // Superclasses' ctors first.
+        for (uint32_t k = 0; k < chain->count; k++) {
+            if (fastpath((*(id(*)(id))chain->entries[k].imp)(obj))) continue;
+
+            // This class's ctor failed. Call superclasses's dtors to clean up.
+            Class supercls = chain->entries[k].cls->getSuperclass();
+            if (supercls) object_cxxDestructFromClass(obj, supercls);
+            objc::freeInstanceMemory(obj);
+            ok = false;
+            break;
+        }
+        if (ok) objs[survivors++] = obj;
+    }
+    return survivors;
+}
+
+
 /***********************************************************************
 * fixupCopiedIvars
 * Fix up ARC strong and ARC-style weak variables 
@@ -842,6 +941,7 @@ char * method_copyArgumentType(Method m, unsigned int index)
     return encoding_copyArgumentType(method_getTypeEncoding(m), index);
 }
 
+#if !__OBJC2__
 /***********************************************************************
 * _class_createInstancesFromZone
 * Batch-allocating version of _class_createInstanceFromZone.
@@ -851,7 +951,8 @@ char * method_copyArgumentType(Method m, unsigned int index)
 **********************************************************************/
 unsigned
 _class_createInstancesFromZone(Class cls, size_t extraBytes, void *zone, 
-                               id *results, unsigned num_requested)
+                               id *results, unsigned num_requested,
+                               int construct_flags __unused)
 {
     unsigned num_allocated;
     if (!cls) return 0;
@@ -885,6 +986,7 @@ _class_createInstancesFromZone(Class cls, size_t extraBytes, void *zone,
 
     return num_allocated - shift;    
 }
+#endif
 
 
 /***********************************************************************
@@ -1057,14 +1159,34 @@ iteratePropertyAttributes(const char *attrs,
 }
 
 
+/***********************************************************************
+* Property descriptors.
+* Serialization code asks for the attributes of every property of 
+* every model class, and every query used to re-tokenize the attribute 
+* string. Each distinct attribute string is now parsed once into an 
+* objc_property_descriptor, which is interned by the string's contents 
+* and never freed. The descriptor holds its own copy of the string 
+* because class_replaceProperty() frees the old one.
+*
+* Repeated queries with the same attribute string pointer skip the 
+* lock, as for _objc_getMethodSignature().
+* Locking: InternedStringLock protects the interned descriptors, 
+* the interned method signatures and the copied trace event names
+**********************************************************************/
+mutex_t InternedStringLock;
+
+static objc::InternedStringCache<objc_property_descriptor, 
+                                 &objc_property_descriptor::attributes, 512>
+    PropertyDescriptors;
+
 static bool 
-copyOneAttribute(unsigned int index, void *ctxa, void *ctxs, 
-                 const char *name, size_t nlen, const char *value, size_t vlen)
+parseOneAttribute(unsigned int index, void *ctxa, void *ctxs, 
+                  const char *name, size_t nlen, const char *value, size_t vlen)
 {
-    objc_property_attribute_t **ap = (objc_property_attribute_t**)ctxa;
+    objc_property_descriptor *desc = (objc_property_descriptor *)ctxa;
     char **sp = (char **)ctxs;
 
-    objc_property_attribute_t *a = *ap;
+    objc_property_attribute_t *a = &desc->attributeList[index];
     char *s = *sp;
 
     a->name = s;
@@ -1077,83 +1199,143 @@ copyOneAttribute(unsigned int index, void *ctxa, void *ctxs,
     s += vlen;
     *s++ = '\0';
 
-    a++;
-    
-    *ap = a;
     *sp = s;
 
+    if (nlen == 1) {
+        switch (name[0]) {
+        case 'T': if (!desc->type) desc->type = a->value; break;
+        case 'V': if (!desc->ivar) desc->ivar = a->value; break;
+        case 'G': if (!desc->getter) desc->getter = a->value; break;
+        case 'S': if (!desc->setter) desc->setter = a->value; break;
+        case 'R': desc->flags |= OBJC_PROPERTY_READONLY; break;
+        case 'C': desc->flags |= OBJC_PROPERTY_COPY; break;
+        case '&': desc->flags |= OBJC_PROPERTY_RETAIN; break;
+        case 'N': desc->flags |= OBJC_PROPERTY_NONATOMIC; break;
+        case 'D': desc->flags |= OBJC_PROPERTY_DYNAMIC; break;
+        case 'W': desc->flags |= OBJC_PROPERTY_WEAK; break;
+        }
+    }
+
     return YES;
 }
 
-                 
-objc_property_attribute_t *
-copyPropertyAttributeList(const char *attrs, unsigned int *outCount)
+static objc_property_descriptor *
+parsePropertyDescriptor(const char *attrs)
 {
-    if (!attrs) {
-        if (outCount) *outCount = 0;
-        return nil;
-    }
-
-    // Result size:
+    // Size:
     //   number of commas plus 1 for the attributes (upper bound)
-    //   plus another attribute for the attribute array terminator
     //   plus strlen(attrs) for name/value string data (upper bound)
     //   plus count*2 for the name/value string terminators (upper bound)
+    //   plus a copy of attrs
     unsigned int attrcount = 1;
-    const char *s;
-    for (s = attrs; s && *s; s++) {
+    for (const char *s = attrs; *s; s++) {
         if (*s == ',') attrcount++;
     }
+    size_t attrsLength = strlen(attrs) + 1;
 
-    size_t size = 
+    size_t size = sizeof(objc_property_descriptor) + 
         attrcount * sizeof(objc_property_attribute_t) + 
-        sizeof(objc_property_attribute_t) + 
-        strlen(attrs) + 
-        attrcount * 2;
-    objc_property_attribute_t *result = (objc_property_attribute_t *) 
-        calloc(size, 1);
+        attrsLength + 
+        attrcount * 2 + 
+        attrsLength;
+    auto desc = (objc_property_descriptor *)calloc(size, 1);
+    char *copy = (char *)&desc->attributeList[attrcount];
+    memcpy(copy, attrs, attrsLength);
+    desc->attributes = copy;
 
-    objc_property_attribute_t *ra = result;
-    char *rs = (char *)(ra+attrcount+1);
+    char *s = copy + attrsLength;
+    desc->attributeCount = 
+        iteratePropertyAttributes(desc->attributes, parseOneAttribute, desc, &s);
 
-    attrcount = iteratePropertyAttributes(attrs, copyOneAttribute, &ra, &rs);
+    ASSERT((uint8_t *)s <= (uint8_t *)desc + size);
 
-    ASSERT((uint8_t *)(ra+1) <= (uint8_t *)result+size);
-    ASSERT((uint8_t *)rs <= (uint8_t *)result+size);
+    return desc;
+}
 
-    if (attrcount == 0) {
-        free(result);
-        result = nil;
-    }
+static const objc_property_descriptor *
+propertyDescriptorForAttributes(const char *attrs)
+{
+    if (!attrs) return nil;
+    return PropertyDescriptors.get(InternedStringLock, attrs, 
+                                   parsePropertyDescriptor);
+}
 
-    if (outCount) *outCount = attrcount;
-    return result;
+static const char *
+propertyDescriptorValue(const objc_property_descriptor *desc, const char *name)
+{
+    if (!desc) return nil;
+
+    for (uint32_t i = 0; i < desc->attributeCount; i++) {
+        if (0 == strcmp(desc->attributeList[i].name, name)) {
+            return desc->attributeList[i].value;
+        }
+    }
+    return nil;
 }
 
 
-static bool 
-findOneAttribute(unsigned int index, void *ctxa, void *ctxs, 
-                 const char *name, size_t nlen, const char *value, size_t vlen)
+objc_property_attribute_t *
+copyPropertyAttributeList(const char *attrs, unsigned int *outCount)
 {
-    const char *query = (char *)ctxa;
-    char **resultp = (char **)ctxs;
-
-    if (strlen(query) == nlen  &&  0 == strncmp(name, query, nlen)) {
-        char *result = (char *)calloc(vlen+1, 1);
-        memcpy(result, value, vlen);
-        result[vlen] = '\0';
-        *resultp = result;
-        return NO;
+    const objc_property_descriptor *desc = propertyDescriptorForAttributes(attrs);
+    if (!desc  ||  desc->attributeCount == 0) {
+        if (outCount) *outCount = 0;
+        return nil;
     }
 
-    return YES;
+    // Result size:
+    //   the attributes plus another for the attribute array terminator
+    //   plus the name/value strings and their terminators
+    unsigned int attrcount = desc->attributeCount;
+    size_t size = (attrcount + 1) * sizeof(objc_property_attribute_t);
+    for (unsigned int i = 0; i < attrcount; i++) {
+        size += strlen(desc->attributeList[i].name) + 1;
+        size += strlen(desc->attributeList[i].value) + 1;
+    }
+
+    objc_property_attribute_t *result = (objc_property_attribute_t *) 
+        calloc(size, 1);
+    char *s = (char *)(result + attrcount + 1);
+    for (unsigned int i = 0; i < attrcount; i++) {
+        size_t len = strlen(desc->attributeList[i].name) + 1;
+        result[i].name = (const char *)memcpy(s, desc->attributeList[i].name, len);
+        s += len;
+        len = strlen(desc->attributeList[i].value) + 1;
+        result[i].value = (const char *)memcpy(s, desc->attributeList[i].value, len);
+        s += len;
+    }
+
+    ASSERT((uint8_t *)s <= (uint8_t *)result + size);
+
+    if (outCount) *outCount = attrcount;
+    return result;
 }
 
+
 char *copyPropertyAttributeValue(const char *attrs, const char *name)
 {
-    char *result = nil;
+    const char *value = 
+        propertyDescriptorValue(propertyDescriptorForAttributes(attrs), name);
+    return value ? strdup(value) : nil;
+}
 
-    iteratePropertyAttributes(attrs, findOneAttribute, (void*)name, &result);
 
-    return result;
+/***********************************************************************
+* _objc_property_getDescriptor
+* _objc_property_getAttributeValue
+* Locking: acquires InternedStringLock the first time an attribute 
+* string is seen
+**********************************************************************/
+const objc_property_descriptor *
+_objc_property_getDescriptor(objc_property_t prop)
+{
+    if (!prop) return nil;
+    return propertyDescriptorForAttributes(property_getAttributes(prop));
+}
+
+const char *
+_objc_property_getAttributeValue(objc_property_t prop, const char *name)
+{
+    if (!prop  ||  !name  ||  *name == '\0') return nil;
+    return propertyDescriptorValue(_objc_property_getDescriptor(prop), name);
 }
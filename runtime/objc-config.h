@@ -160,6 +160,14 @@
 #   define SUPPORT_AUTORELEASEPOOL_DEDUP_PTRS 1
 #endif
 
+// Define SUPPORT_SEGREGATED_ALLOC to allow allocating small instances
+// from size-segregated slabs (OBJC_SEGREGATED_ALLOC)
+#if !__LP64__ || !__OBJC2__ || TARGET_OS_WIN32
+#   define SUPPORT_SEGREGATED_ALLOC 0
+#else
+#   define SUPPORT_SEGREGATED_ALLOC 1
+#endif
+
 // Define HAVE_TASK_RESTARTABLE_RANGES to enable usage of
 // task_restartable_ranges_synchronize()
 #if TARGET_OS_SIMULATOR || defined(__i386__) || defined(__arm__) || !TARGET_OS_MAC
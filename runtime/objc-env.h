@@ -25,7 +25,10 @@ OPTION( PrintPoolHiwat,           OBJC_PRINT_POOL_HIGHWATER,       "log high-wat
 OPTION( PrintCustomCore,          OBJC_PRINT_CUSTOM_CORE,          "log classes with custom core methods")
 OPTION( PrintCustomRR,            OBJC_PRINT_CUSTOM_RR,            "log classes with custom retain/release methods")
 OPTION( PrintCustomAWZ,           OBJC_PRINT_CUSTOM_AWZ,           "log classes with custom allocWithZone methods")
+OPTION( PrintCustomDealloc,       OBJC_PRINT_CUSTOM_DEALLOC,       "log classes with custom dealloc methods")
 OPTION( PrintRawIsa,              OBJC_PRINT_RAW_ISA,              "log classes that require raw pointer isa fields")
+OPTION( ProfileRC,                OBJC_PROFILE_RC,                 "record per-class retain/release samples, retain count overflows and slow deallocations for _objc_copyRCProfile()")
+OPTION( RecordTrace,              OBJC_RECORD_TRACE,               "record image loading, class setup, +load and +initialize times for _objc_copyTraceJSON()")
 
 OPTION( DebugUnload,              OBJC_DEBUG_UNLOAD,               "warn about poorly-behaving bundles when unloaded")
 OPTION( DebugFragileSuperclasses, OBJC_DEBUG_FRAGILE_SUPERCLASSES, "warn about subclasses that may have been broken by subsequent changes to superclasses")
@@ -48,3 +51,12 @@ OPTION( DisableFaults,            OBJC_DISABLE_FAULTS,             "disable os f
 OPTION( DisablePreoptCaches,      OBJC_DISABLE_PREOPTIMIZED_CACHES, "disable preoptimized caches")
 OPTION( DisableAutoreleaseCoalescing, OBJC_DISABLE_AUTORELEASE_COALESCING, "disable coalescing of autorelease pool pointers")
 OPTION( DisableAutoreleaseCoalescingLRU, OBJC_DISABLE_AUTORELEASE_COALESCING_LRU, "disable coalescing of autorelease pool pointers using look back N strategy")
+OPTION( DisableMethodIndex,       OBJC_DISABLE_METHOD_INDEX,       "disable merged selector indexes for classes with many method lists")
+OPTION( DisableScopedCacheFlush,  OBJC_DISABLE_SCOPED_CACHE_FLUSH, "disable removing only the affected selectors from method caches when methods change")
+OPTION( NegativeLookupFilter,     OBJC_NEGATIVE_LOOKUP_FILTER,     "build per-class filters that short-circuit lookups of unimplemented selectors")
+OPTION( SegregatedAlloc,          OBJC_SEGREGATED_ALLOC,           "allocate small instances of classes with default alloc and dealloc from size-segregated slabs")
+OPTION( CoalesceRetainRelease,    OBJC_COALESCE_RETAIN_RELEASE,    "postpone ARC releases briefly so that a following retain of the same object on the same thread cancels both")
+OPTION( OutOfLineRC,              OBJC_OUT_OF_LINE_RC,             "keep retain counts that overflow a nonpointer isa in per-object counters instead of the side table")
+OPTION( DeferredRC,               OBJC_DEFERRED_RC,                "let the allocating thread retain and release new objects without atomic operations until they die or its autorelease pool is popped")
+OPTION( LockFreeProperties,       OBJC_LOCK_FREE_PROPERTIES,       "use atomic operations instead of striped spinlocks in atomic property accessors")
+OPTION( ParallelImageFixups,      OBJC_PARALLEL_IMAGE_FIXUPS,      "fix up selector references of newly mapped images on multiple threads")
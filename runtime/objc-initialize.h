@@ -36,6 +36,8 @@ extern void _destroyInitializingClassList(struct _objc_initializing_classes *lis
 
 extern bool _thisThreadIsInitializingClass(Class cls);
 
+extern void _initializeWaitQueuesForceReset(void);
+
 __END_DECLS
 
 #endif
@@ -97,11 +97,35 @@
 #include "objc-initialize.h"
 #include "DenseMapExtras.h"
 
-/* classInitLock protects CLS_INITIALIZED and CLS_INITIALIZING, and 
- * is signalled when any class is done initializing. 
- * Threads that are waiting for a class to finish initializing wait on this. */
+/* classInitLock protects CLS_INITIALIZED and CLS_INITIALIZING.
+ * Threads that are waiting for a class to finish initializing wait on 
+ * that class's stripe of InitializeWaitQueues with classInitLock, so 
+ * finishing a class wakes only the threads waiting for it and for 
+ * classes that share its stripe. */
 monitor_t classInitLock;
 
+struct InitializeWaitQueue {
+    pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+
+    void notifyAll() {
+        int err = pthread_cond_broadcast(&cond);
+        if (err) _objc_fatal("pthread_cond_broadcast failed (%d)", err);
+    }
+
+    void forceReset() {
+        bzero(&cond, sizeof(cond));
+        cond = pthread_cond_t PTHREAD_COND_INITIALIZER;
+    }
+};
+
+static StripedMap<InitializeWaitQueue> InitializeWaitQueues;
+
+// The fork child has none of the parent's waiting threads.
+void _initializeWaitQueuesForceReset(void)
+{
+    InitializeWaitQueues.forceResetAll();
+}
+
 
 struct _objc_willInitializeClassCallback {
     _objc_func_willInitializeClass f;
@@ -297,7 +321,7 @@ static void _finishInitializing(Class cls, Class supercls)
 
     // mark this class as fully +initialized
     cls->setInitialized();
-    classInitLock.notifyAll();
+    InitializeWaitQueues[cls].notifyAll();
     _setThisThreadIsNotInitializingClass(cls);
     
     // mark any subclasses that were merely waiting for this class
@@ -373,7 +397,7 @@ void waitForInitializeToComplete(Class cls)
 
     monitor_locker_t lock(classInitLock);
     while (!cls->isInitialized()) {
-        classInitLock.wait();
+        classInitLock.wait(InitializeWaitQueues[cls].cond);
     }
     asm("");
 }
@@ -381,6 +405,7 @@ void waitForInitializeToComplete(Class cls)
 
 void callInitialize(Class cls)
 {
+    objc::TraceScope trace("initialize", [&]{ return cls->mangledName(); });
     ((void(*)(Class, SEL))objc_msgSend)(cls, @selector(initialize));
     asm("");
 }
@@ -533,6 +558,12 @@ void initializeNonMetaClass(Class cls)
         for (auto callback : localWillInitializeFuncs)
             callback.f(callback.context, cls);
 
+#if __OBJC2__
+        // Look up C++ ivar constructors and destructors before the
+        // first allocation instead of during it.
+        objc::cxxChainsPrepare(cls);
+#endif
+
         // Send the +initialize message.
         // Note that +initialize is sent to the superclass (again) if 
         // this class doesn't implement +initialize. 2157218
@@ -112,6 +112,31 @@ class_createInstances(Class _Nullable cls, size_t extraBytes,
     OBJC_AVAILABLE(10.7, 4.3, 9.0, 1.0, 2.0)
     OBJC_ARC_UNAVAILABLE;
 
+// Batch equivalent of sending +alloc count times, for object pools 
+// and decoders that create many instances of one class at once.
+// Returns the number of objects allocated into results.
+// Each object must be initialized individually.
+OBJC_EXPORT unsigned
+objc_allocInstances(Class _Nullable cls, 
+                    id _Nonnull * _Nonnull results, unsigned count)
+    OBJC_AVAILABLE(12.0, 15.0, 15.0, 8.0, 6.0)
+    OBJC_ARC_UNAVAILABLE;
+
+// Batch equivalent of sending -release to each object, for tearing 
+// down collections. Nil entries are ignored. Objects that use 
+// NSObject's -dealloc are deallocated together without sending -dealloc.
+OBJC_EXPORT void
+objc_releaseObjects(id _Nullable * _Nonnull objects, unsigned count)
+    OBJC_AVAILABLE(12.0, 15.0, 15.0, 8.0, 6.0)
+    OBJC_ARC_UNAVAILABLE;
+
+// Number of retain/release pairs the calling thread has dropped 
+// with OBJC_COALESCE_RETAIN_RELEASE. Each pair saves two atomic 
+// updates of an object's retain count.
+OBJC_EXPORT uint64_t
+objc_coalescedRetainReleaseCount(void)
+    OBJC_AVAILABLE(12.0, 15.0, 15.0, 8.0, 6.0);
+
 // Get the isa pointer written into objects just before being freed.
 OBJC_EXPORT Class _Nonnull
 _objc_getFreedObjectClass(void)
@@ -182,8 +207,196 @@ OBJC_EXPORT
 unsigned long
 sel_hash(SEL _Nullable sel)
     OBJC_AVAILABLE(10.16, 14.0, 14.0, 7.0, 6.0);
+
+// Enumerators that visit the same entries as objc_copyClassList() and
+// the class_copy*List() functions without allocating. fn is called 
+// without any runtime lock held, so it may call back into the runtime.
+// fn returns false to stop. Entries added during enumeration may or 
+// may not be visited. Each returns the number of entries visited.
+// If classes are freed or change superclass during _objc_enumerateClasses(),
+// other classes may be visited again or skipped.
+OBJC_EXPORT unsigned int
+_objc_enumerateClasses(bool (* _Nonnull fn)(Class _Nonnull cls, 
+                                            void * _Nullable context),
+                       void * _Nullable context)
+    OBJC_AVAILABLE(12.0, 15.0, 15.0, 8.0, 6.0);
+
+OBJC_EXPORT unsigned int
+_class_enumerateMethods(Class _Nullable cls,
+                        bool (* _Nonnull fn)(Method _Nonnull method, 
+                                             void * _Nullable context),
+                        void * _Nullable context)
+    OBJC_AVAILABLE(12.0, 15.0, 15.0, 8.0, 6.0);
+
+OBJC_EXPORT unsigned int
+_class_enumerateIvars(Class _Nullable cls,
+                      bool (* _Nonnull fn)(Ivar _Nonnull ivar, 
+                                           void * _Nullable context),
+                      void * _Nullable context)
+    OBJC_AVAILABLE(12.0, 15.0, 15.0, 8.0, 6.0);
+
+OBJC_EXPORT unsigned int
+_class_enumerateProperties(Class _Nullable cls,
+                           bool (* _Nonnull fn)(objc_property_t _Nonnull property,
+                                                void * _Nullable context),
+                           void * _Nullable context)
+    OBJC_AVAILABLE(12.0, 15.0, 15.0, 8.0, 6.0);
+
+OBJC_EXPORT unsigned int
+_class_enumerateProtocols(Class _Nullable cls,
+                          bool (* _Nonnull fn)(Protocol * __unsafe_unretained _Nonnull protocol,
+                                               void * _Nullable context),
+                          void * _Nullable context)
+    OBJC_AVAILABLE(12.0, 15.0, 15.0, 8.0, 6.0);
+
+// A snapshot of the realized classes made by _objc_copyClassSnapshot().
+// Apart from the class addresses it holds no pointers, so it can be 
+// written to a file and mapped back in for offline analysis.
+#define OBJC_CLASS_SNAPSHOT_MAGIC 0x534a424f  /* 'OBJS' */
+#define OBJC_CLASS_SNAPSHOT_VERSION 1
+#define OBJC_CLASS_SNAPSHOT_NO_SUPERCLASS 0xffffffffu
+
+enum {
+    OBJC_CLASS_SNAPSHOT_INITIALIZED = 1 << 0,
+    OBJC_CLASS_SNAPSHOT_SWIFT       = 1 << 1,
+    OBJC_CLASS_SNAPSHOT_CXX_CTOR    = 1 << 2,
+    OBJC_CLASS_SNAPSHOT_CXX_DTOR    = 1 << 3,
+    OBJC_CLASS_SNAPSHOT_CUSTOM_RR   = 1 << 4,
+    OBJC_CLASS_SNAPSHOT_CUSTOM_AWZ  = 1 << 5,
+    OBJC_CLASS_SNAPSHOT_RAW_ISA     = 1 << 6,
+};
+
+typedef struct objc_class_snapshot_entry {
+    uint64_t address;
+    uint32_t nameOffset;       // from the snapshot's stringsOffset
+    uint32_t superclassIndex;  // or OBJC_CLASS_SNAPSHOT_NO_SUPERCLASS
+    uint32_t instanceSize;
+    uint32_t flags;
+    uint32_t methodCount;
+    uint32_t classMethodCount;
+    uint32_t ivarCount;
+    uint32_t propertyCount;
+    uint32_t protocolCount;
+    uint32_t cacheOccupied;
+    uint32_t cacheCapacity;
+    uint32_t reserved;
+} objc_class_snapshot_entry;
+
+typedef struct objc_class_snapshot {
+    uint32_t magic;            // OBJC_CLASS_SNAPSHOT_MAGIC
+    uint32_t version;          // OBJC_CLASS_SNAPSHOT_VERSION
+    uint32_t classCount;
+    uint32_t entrySize;        // sizeof(objc_class_snapshot_entry)
+    uint64_t stringsOffset;    // from the start of the snapshot
+    uint64_t size;             // of the whole snapshot
+    objc_class_snapshot_entry classes[];
+} objc_class_snapshot;
+
+// Describes every realized class, taken in one pass under the 
+// runtime lock so that the entries are consistent with each other.
+// Superclasses come before their subclasses. Unrealized classes are 
+// not included. The caller must free() the result.
+OBJC_EXPORT objc_class_snapshot * _Nonnull
+_objc_copyClassSnapshot(void)
+    OBJC_AVAILABLE(12.0, 15.0, 15.0, 8.0, 6.0);
 #endif
 
+// Returns the startup trace events recorded when OBJC_RECORD_TRACE=YES
+// (image loading phases, category attachment, class realization, 
+// +load and +initialize) in Chrome trace event JSON format.
+// Only the most recent events are kept. Returns NULL if tracing 
+// is not enabled. The caller must free() the result.
+OBJC_EXPORT
+char * _Nullable
+_objc_copyTraceJSON(void)
+    OBJC_AVAILABLE(12.0, 15.0, 15.0, 8.0, 6.0);
+
+
+// Retain count profile of one class. See _objc_copyRCProfile().
+typedef struct objc_rc_profile_entry {
+    Class _Nonnull cls;
+    uint64_t retains;           // estimated from samples
+    uint64_t releases;          // estimated from samples
+    uint64_t overflows;         // extra_rc overflows
+    uint64_t borrows;           // extra_rc underflows that borrowed counts
+    uint64_t weakDeallocs;      // deallocations that cleared weak references
+    uint64_t assocDeallocs;     // deallocations that removed associations
+    uint64_t cxxDtorDeallocs;   // deallocations that ran C++ destructors
+    uint64_t sideTableDeallocs; // deallocations with side table retain counts
+} objc_rc_profile_entry;
+
+// Returns per-class retain count statistics recorded when 
+// OBJC_PROFILE_RC=YES, busiest classes first. Returns NULL if 
+// profiling is not enabled. The caller must free() the result.
+OBJC_EXPORT
+objc_rc_profile_entry * _Nullable
+_objc_copyRCProfile(unsigned int * _Nullable outCount)
+    OBJC_AVAILABLE(12.0, 15.0, 15.0, 8.0, 6.0);
+
+
+// A method type string parsed by _objc_getMethodSignature().
+typedef struct objc_method_argument {
+    const char * _Nonnull type;  // this argument's type, NUL-terminated
+    int32_t offset;              // frame offset relative to self
+    uint32_t position;           // index of type in the type string
+    char code;                   // type code after any qualifiers, like '@'
+} objc_method_argument;
+
+typedef struct objc_method_signature {
+    const char * _Nonnull types;       // a copy of the whole type string
+    const char * _Nonnull returnType;  // NUL-terminated
+    char returnCode;                   // type code after any qualifiers
+    uint32_t frameSize;
+    uint32_t argumentCount;            // including self and _cmd
+    objc_method_argument arguments[];
+} objc_method_signature;
+
+// Returns the parsed form of a method type string such as 
+// method_getTypeEncoding() returns. Each distinct string is parsed 
+// once. The result is shared and must not be freed or modified.
+// Returns NULL if types is NULL.
+OBJC_EXPORT const objc_method_signature * _Nullable
+_objc_getMethodSignature(const char * _Nullable types)
+    OBJC_AVAILABLE(12.0, 15.0, 15.0, 8.0, 6.0);
+
+
+// Flags in objc_property_descriptor, one per valueless attribute.
+enum {
+    OBJC_PROPERTY_READONLY  = 1 << 0,  // R
+    OBJC_PROPERTY_COPY      = 1 << 1,  // C
+    OBJC_PROPERTY_RETAIN    = 1 << 2,  // &
+    OBJC_PROPERTY_NONATOMIC = 1 << 3,  // N
+    OBJC_PROPERTY_DYNAMIC   = 1 << 4,  // D
+    OBJC_PROPERTY_WEAK      = 1 << 5,  // W
+};
+
+// A property attribute string parsed by _objc_property_getDescriptor().
+// Strings are NULL if the attribute is absent.
+typedef struct objc_property_descriptor {
+    const char * _Nonnull attributes;  // a copy of the attribute string
+    const char * _Nullable type;       // T
+    const char * _Nullable ivar;       // V
+    const char * _Nullable getter;     // G
+    const char * _Nullable setter;     // S
+    uint32_t flags;
+    uint32_t attributeCount;
+    objc_property_attribute_t attributeList[];
+} objc_property_descriptor;
+
+// Returns the parsed attributes of a property. Each distinct attribute
+// string is parsed once. The result is shared and must not be freed 
+// or modified. Returns NULL if property is NULL.
+OBJC_EXPORT const objc_property_descriptor * _Nullable
+_objc_property_getDescriptor(objc_property_t _Nullable property)
+    OBJC_AVAILABLE(12.0, 15.0, 15.0, 8.0, 6.0);
+
+// Like property_copyAttributeValue(), but returns the descriptor's
+// string instead of a copy. Do not free the result.
+OBJC_EXPORT const char * _Nullable
+_objc_property_getAttributeValue(objc_property_t _Nullable property,
+                                 const char * _Nullable attributeName)
+    OBJC_AVAILABLE(12.0, 15.0, 15.0, 8.0, 6.0);
+
 
 // Plainly-implemented GC barriers. Rosetta used to use these.
 OBJC_EXPORT id _Nullable
@@ -1019,6 +1232,34 @@ typedef void (*_objc_func_willInitializeClass)(void * _Nullable context, Class _
 OBJC_EXPORT void _objc_addWillInitializeClassFunc(_objc_func_willInitializeClass _Nonnull func, void * _Nullable context)
     OBJC_AVAILABLE(10.15, 13.0, 13.0, 6.0, 4.0);
 
+/**
+ * Send +initialize to the given classes and their superclasses now
+ * instead of at their first message, for example before a service
+ * starts taking requests. Independent class hierarchies are initialized
+ * in parallel on a worker pool, superclasses before subclasses.
+ * Returns when all of the classes are initialized.
+ *
+ * +initialize methods run on the worker threads. A +initialize that
+ * waits for work on another thread that itself needs a class being
+ * initialized by this call can deadlock, as with any threads.
+ *
+ * @param classes The classes to initialize. Nil entries and
+ *   metaclasses are ignored.
+ * @param count The number of entries in classes.
+ */
+OBJC_EXPORT void
+objc_initializeClasses(Class _Nullable const * _Nullable classes,
+                       unsigned int count)
+    OBJC_AVAILABLE(12.0, 15.0, 15.0, 8.0, 6.0);
+
+/**
+ * objc_initializeClasses() for every class in the named image.
+ * The image name must be identical to dladdr's dli_fname value.
+ */
+OBJC_EXPORT void
+objc_initializeClassesForImage(const char * _Nonnull image)
+    OBJC_AVAILABLE(12.0, 15.0, 15.0, 8.0, 6.0);
+
 // Replicate the conditionals in objc-config.h for packed isa, indexed isa, and preopt caches
 #if __ARM_ARCH_7K__ >= 2  ||  (__arm64__ && !__LP64__) || \
     !(!__LP64__  ||  TARGET_OS_WIN32  ||  \
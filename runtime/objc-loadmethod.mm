@@ -201,6 +201,7 @@ static void call_class_loads(void)
         if (PrintLoading) {
             _objc_inform("LOAD: +[%s load]\n", cls->nameForLogging());
         }
+        objc::TraceScope trace("load", [&]{ return cls->mangledName(); });
         (*load_method)(cls, @selector(load));
     }
     
@@ -248,6 +249,7 @@ static bool call_category_loads(void)
                              cls->nameForLogging(), 
                              _category_getName(cat));
             }
+            objc::TraceScope trace("load", [&]{ return _category_getName(cat); });
             (*load_method)(cls, @selector(load));
             cats[i].cat = nil;
         }
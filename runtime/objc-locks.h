@@ -42,12 +42,14 @@ extern mutex_t cacheUpdateLock;
 #endif
 extern recursive_mutex_t loadMethodLock;
 extern mutex_t crashlog_lock;
+extern mutex_t InternedStringLock;
 extern spinlock_t objcMsgLogLock;
 extern mutex_t AltHandlerDebugLock;
 extern mutex_t AssociationsManagerLock;
 extern StripedMap<spinlock_t> PropertyLocks;
 extern StripedMap<spinlock_t> StructLocks;
 extern StripedMap<spinlock_t> CppObjectLocks;
+extern StripedMap<spinlock_t> RCCounterLocks;
 
 // SideTable lock is buried awkwardly. Call a function to manipulate it.
 extern void SideTableLockAll();
@@ -328,6 +328,23 @@ objc_object::initInstanceIsa(Class cls, bool hasCxxDtor)
     initIsa(cls, true, hasCxxDtor);
 }
 
+#if ISA_HAS_BIASED_RC_BIT
+// Marks a new object as having references counted by its allocating
+// thread. The inline count starts at RC_HALF instead of 1 so that 
+// other threads can release the allocating thread's references
+// without reaching zero. Called before the object is visible to 
+// other threads.
+inline void
+objc_object::initBiasedRC()
+{
+    ASSERT(isa.nonpointer  &&  !isa.biased_rc);
+    ASSERT(isa.extra_rc == 1  &&  !isa.has_sidetable_rc);
+
+    isa.biased_rc = 1;
+    isa.extra_rc = RC_HALF;
+}
+#endif
+
 #if !SUPPORT_INDEXED_ISA && !ISA_HAS_CXX_DTOR_BIT
 #define UNUSED_WITHOUT_INDEXED_ISA_AND_DTOR_BIT __attribute__((unused))
 #else
@@ -395,6 +412,18 @@ objc_object::changeIsa(Class newCls)
 
     oldisa = LoadExclusive(&isa.bits);
 
+#if ISA_HAS_BIASED_RC_BIT
+    if (slowpath(oldisa.nonpointer  &&  oldisa.biased_rc)  &&
+        (newCls->isFuture()  ||  !newCls->canAllocNonpointer()))
+    {
+        // A raw isa can't hold the deferred count. If another thread
+        // owns it, the transcription below detaches it instead.
+        ClearExclusive(&isa.bits);
+        objc::rcBiasRelinquish(this);
+        oldisa = LoadExclusive(&isa.bits);
+    }
+#endif
+
     do {
         transcribeToSideTable = false;
         if ((oldisa.bits == 0  ||  oldisa.nonpointer)  &&
@@ -450,9 +479,18 @@ objc_object::changeIsa(Class newCls)
         // Copy oldisa's retain count et al to side table.
         // oldisa.has_assoc: nothing to do
         // oldisa.has_cxx_dtor: nothing to do
-        sidetable_moveExtraRC_nolock(oldisa.extra_rc, 
+        size_t extra_rc = oldisa.extra_rc;
+        if (slowpath(OutOfLineRC)  &&  oldisa.has_sidetable_rc  &&
+            oldisa.canUseRCCounter())
+        {
+            extra_rc += objc::rcCounterTake(this);
+        }
+        sidetable_moveExtraRC_nolock(extra_rc, 
                                      oldisa.isDeallocating(),
                                      oldisa.weakly_referenced);
+#if ISA_HAS_BIASED_RC_BIT
+        if (slowpath(oldisa.biased_rc)) sidetable_detachBias_nolock();
+#endif
     }
 
     if (sideTableLocked) sidetable_unlock();
@@ -564,33 +602,86 @@ objc_object::clearDeallocating()
 }
 
 
+inline bool
+objc_object::hasSideTableEntries()
+{
+    return !isa.nonpointer  ||  isa.weakly_referenced  ||  isa.has_sidetable_rc;
+}
+
+
+// 判断是否为优化 isa 指针、是否有弱引用、是否有关联对象、是否有析构函数、是否有引用计数表
+inline bool
+objc_object::canFreeWithoutDestruct()
+{
+    return (isa.nonpointer                     &&
+            !isa.weakly_referenced             &&
+            !isa.has_assoc                     &&
+#if ISA_HAS_CXX_DTOR_BIT
+            !isa.has_cxx_dtor                  &&
+#else
+            !isa.getClass(false)->hasCxxDtor() &&
+#endif
+            !isa.has_sidetable_rc);
+}
+
+// True if C++ destructors are all that may stand between the object 
+// and free(). Only meaningful if canFreeWithoutDestruct() is false.
+inline bool
+objc_object::canFreeAfterCxxDestruct()
+{
+    return (isa.nonpointer                     &&
+            !isa.weakly_referenced             &&
+            !isa.has_assoc                     &&
+            !isa.has_sidetable_rc);
+}
+
+
 inline void
 objc_object::rootDealloc()
 {
     // taggedPointer 返回
     if (isTaggedPointer()) return;  // fixme necessary?
 
-    // 判断是否为优化 isa 指针、是否有弱引用、是否有关联对象、是否有析构函数、是否有引用计数表
-    if (fastpath(isa.nonpointer                     &&
-                 !isa.weakly_referenced             &&
-                 !isa.has_assoc                     &&
-#if ISA_HAS_CXX_DTOR_BIT
-                 !isa.has_cxx_dtor                  &&
-#else
-                 !isa.getClass(false)->hasCxxDtor() &&
-#endif
-                 !isa.has_sidetable_rc))
+    if (fastpath(canFreeWithoutDestruct()))
     {
         assert(!sidetable_present());
         // 都不存在， 调用 free释放内存
-        free(this);
+        objc::freeInstanceMemory(this);
     } 
+    else if (fastpath(canFreeAfterCxxDestruct())) {
+        if (slowpath(ProfileRC)) objc::rcProfileDealloc(this);
+        // Skip objc_destructInstance's other checks. The destructors
+        // may still give the object associations while they run.
+        object_cxxDestruct((id)this);
+        if (slowpath(isa.has_assoc)) {
+            _object_remove_assocations((id)this, /*deallocating*/true);
+        }
+        clearDeallocating();
+        objc::freeInstanceMemory(this);
+    }
     else {
+        if (slowpath(ProfileRC)) objc::rcProfileDealloc(this);
         // 处理对象关联的数据
         object_dispose((id)this);
     }
 }
 
+// True if a -release now would neither deallocate the object nor call
+// an override, so it may be postponed (OBJC_COALESCE_RETAIN_RELEASE).
+// parked is the number of releases of this object already postponed.
+inline bool
+objc_object::canDeferRelease(uintptr_t parked)
+{
+    isa_t bits = __c11_atomic_load((_Atomic uintptr_t *)&isa.bits, __ATOMIC_RELAXED);
+    if (!bits.nonpointer) return false;
+#if ISA_HAS_BIASED_RC_BIT
+    // The owner's releases of biased objects are already cheap.
+    if (bits.biased_rc) return false;
+#endif
+    if (bits.getDecodedClass(false)->hasCustomRR()) return false;
+    return bits.extra_rc > 1 + parked  ||  bits.has_sidetable_rc;
+}
+
 extern explicit_atomic<id(*)(id)> swiftRetain;
 extern explicit_atomic<void(*)(id)> swiftRelease;
 
@@ -649,6 +740,21 @@ objc_object::rootRetain(bool tryRetain, objc_object::RRVariant variant)
         }
     }
 
+    if (slowpath(ProfileRC)  &&  variant != RRVariant::Full) {
+        objc::rcProfileSample(this, objc::RCProfileRetain);
+    }
+
+#if ISA_HAS_BIASED_RC_BIT
+    if (slowpath(oldisa.nonpointer  &&  oldisa.biased_rc)  &&
+        variant != RRVariant::Full)
+    {
+        // The owning thread counts its references without atomics.
+        ClearExclusive(&isa.bits);
+        if (objc::rcBiasRetain(this)) return (id)this;
+        oldisa = LoadExclusive(&isa.bits);
+    }
+#endif
+
     if (slowpath(!oldisa.nonpointer)) {
         // a Class is a Class forever, so we can perform this check once
         // outside of the CAS loop
@@ -692,6 +798,14 @@ objc_object::rootRetain(bool tryRetain, objc_object::RRVariant variant)
             // prepare to copy the other half to the side table.
             if (!tryRetain && !sideTableLocked) sidetable_lock();
             sideTableLocked = true;
+            if (slowpath(OutOfLineRC)  &&  oldisa.canUseRCCounter()  &&
+                objc::rcCounterExists(this))
+            {
+                // Another thread moved the overflow out of line.
+                ClearExclusive(&isa.bits);
+                if (!tryRetain) sidetable_unlock();
+                return rootRetain_counter(tryRetain);
+            }
             transcribeToSideTable = true;
             newisa.extra_rc = RC_HALF;
             newisa.has_sidetable_rc = true;
@@ -700,8 +814,14 @@ objc_object::rootRetain(bool tryRetain, objc_object::RRVariant variant)
 
     if (variant == RRVariant::Full) {
         if (slowpath(transcribeToSideTable)) {
-            // Copy the other half of the retain counts to the side table.
-            sidetable_addExtraRC_nolock(RC_HALF);
+            // Copy the other half of the retain counts to the side table,
+            // or to a new out-of-line counter if the side table has none.
+            if (!(slowpath(OutOfLineRC)  &&  !oldisa.has_sidetable_rc  &&
+                  oldisa.canUseRCCounter()  &&
+                  objc::rcCounterInstall(this, RC_HALF)))
+            {
+                sidetable_addExtraRC_nolock(RC_HALF);
+            }
         }
 
         if (slowpath(!tryRetain && sideTableLocked)) sidetable_unlock();
@@ -772,6 +892,37 @@ objc_object::rootRelease(bool performDealloc, objc_object::RRVariant variant)
         }
     }
 
+    if (slowpath(ProfileRC)  &&  variant != RRVariant::Full) {
+        objc::rcProfileSample(this, objc::RCProfileRelease);
+    }
+
+#if ISA_HAS_BIASED_RC_BIT
+    if (slowpath(oldisa.nonpointer  &&  oldisa.biased_rc)  &&
+        variant != RRVariant::Full)
+    {
+        ClearExclusive(&isa.bits);
+        switch (objc::rcBiasRelease(this)) {
+        case objc::RCBiasRelease::Released:
+            return false;
+        case objc::RCBiasRelease::Dealloc:
+            newisa = LoadExclusive(&isa.bits);
+            ClearExclusive(&isa.bits);
+            if (slowpath(!newisa.nonpointer)) {
+                // Detached; the side table says it is deallocating.
+                __c11_atomic_thread_fence(__ATOMIC_ACQUIRE);
+                if (performDealloc) {
+                    ((void(*)(objc_object *, SEL))objc_msgSend)(this, @selector(dealloc));
+                }
+                return true;
+            }
+            goto deallocate;
+        case objc::RCBiasRelease::NotOwner:
+            break;
+        }
+        oldisa = LoadExclusive(&isa.bits);
+    }
+#endif
+
     //
     if (slowpath(!oldisa.nonpointer)) {
         // a Class is a Class forever, so we can perform this check once
@@ -814,6 +965,11 @@ retry:
             // don't ClearExclusive()
             goto underflow;
         }
+#if ISA_HAS_BIASED_RC_BIT
+        if (slowpath(newisa.biased_rc  &&  newisa.isDeallocating())) {
+            goto biased;
+        }
+#endif
     }
     // 然后存储 new 到 isa 中，StoreReleaseExclusive使用了 CAS先比较 isa 和 oldisa 是否发生变化，没有变化赋值， 否则重新执行 do 结构计算， 防止流程执行过程中 isa 已经被修改
     while (slowpath(!StoreReleaseExclusive(&isa.bits, &oldisa.bits, newisa.bits)));
@@ -860,6 +1016,21 @@ retry:
             goto retry;
         }
 
+        if (slowpath(OutOfLineRC)  &&  newisa.canUseRCCounter()  &&
+            objc::rcCounterExists(this))
+        {
+            // Another thread moved the overflow out of line.
+            ClearExclusive(&isa.bits);
+            sidetable_unlock();
+            return rootRelease_counter(performDealloc);
+        }
+
+#if ISA_HAS_BIASED_RC_BIT
+        if (slowpath(newisa.biased_rc)  &&  sidetable_getExtraRC_nolock() <= 1) {
+            goto biased;
+        }
+#endif
+
         // Try to remove some retain counts from the side table.
         
         // 引用表借用 128， 返回结构体 borrowed（借用 == 128）, remaining（剩余计数）：{borrowed， remaining}
@@ -944,6 +1115,32 @@ retry:
         }
     }
 
+#if ISA_HAS_BIASED_RC_BIT
+    // Don't fall through into the bias debt path.
+    goto deallocate;
+
+ biased:
+    // The owning thread still holds references that are not in the 
+    // inline count, so this release must not reach zero. Record it
+    // as a debt that the owner settles in rootMergeBias().
+    ClearExclusive(&isa.bits);
+    if (variant != RRVariant::Full) {
+        return rootRelease_underflow(performDealloc);
+    }
+    if (!sideTableLocked) {
+        sidetable_lock();
+        sideTableLocked = true;
+        oldisa = LoadExclusive(&isa.bits);
+        goto retry;
+    }
+    if (!sidetable_addBiasDebt_nolock(oldisa)) {
+        oldisa = LoadExclusive(&isa.bits);
+        goto retry;
+    }
+    sidetable_unlock();
+    return false;
+#endif
+
 deallocate:
     // Really deallocate.
 
@@ -995,6 +1192,11 @@ objc_object::rootRetainCount()
 {
     if (isTaggedPointer()) return (uintptr_t)this;
 
+    if (slowpath(OutOfLineRC)) {
+        uintptr_t rc;
+        if (objc::rcCounterRetainCount(this, &rc)) return rc;
+    }
+
     sidetable_lock();
     isa_t bits = __c11_atomic_load((_Atomic uintptr_t *)&isa.bits, __ATOMIC_RELAXED);
     if (bits.nonpointer) {
@@ -1002,6 +1204,11 @@ objc_object::rootRetainCount()
         if (bits.has_sidetable_rc) {
             rc += sidetable_getExtraRC_nolock();
         }
+#if ISA_HAS_BIASED_RC_BIT
+        if (slowpath(bits.biased_rc)) {
+            rc = objc::rcBiasRetainCount_nolock(this, rc);
+        }
+#endif
         sidetable_unlock();
         return rc;
     }
@@ -1167,6 +1374,27 @@ objc_object::clearDeallocating()
 }
 
 
+inline bool
+objc_object::hasSideTableEntries()
+{
+    return true;
+}
+
+
+inline bool
+objc_object::canFreeWithoutDestruct()
+{
+    return false;
+}
+
+
+inline bool
+objc_object::canFreeAfterCxxDestruct()
+{
+    return false;
+}
+
+
 inline void
 objc_object::rootDealloc()
 {
@@ -1175,6 +1403,13 @@ objc_object::rootDealloc()
 }
 
 
+inline bool
+objc_object::canDeferRelease(uintptr_t parked __unused)
+{
+    return false;
+}
+
+
 // Equivalent to calling [this retain], with shortcuts if there is no override
 inline id 
 objc_object::retain()
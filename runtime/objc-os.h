@@ -372,6 +372,15 @@ extern void _objc_fatal_with_reason(uint64_t reason, uint64_t flags,
 # if SUPPORT_RETURN_AUTORELEASE
 #   define RETURN_DISPOSITION_KEY ((tls_key_t)__PTK_FRAMEWORK_OBJC_KEY4)
 # endif
+# if SUPPORT_SEGREGATED_ALLOC
+#   define SLAB_CACHE_DIRECT_KEY ((tls_key_t)__PTK_FRAMEWORK_OBJC_KEY5)
+# endif
+# if ISA_HAS_BIASED_RC_BIT
+#   define RC_BIAS_DIRECT_KEY    ((tls_key_t)__PTK_FRAMEWORK_OBJC_KEY6)
+# endif
+#   define PENDING_RELEASE_KEY   ((tls_key_t)__PTK_FRAMEWORK_OBJC_KEY7)
+#   define RC_PROFILE_KEY        ((tls_key_t)__PTK_FRAMEWORK_OBJC_KEY8)
+#   define PROPERTY_HAZARD_KEY   ((tls_key_t)__PTK_FRAMEWORK_OBJC_KEY9)
 #else
 #   define SUPPORT_DIRECT_THREAD_KEYS 0
 #endif
@@ -673,6 +682,15 @@ static inline bool is_valid_direct_key(tls_key_t k) {
 #   if SUPPORT_RETURN_AUTORELEASE
             || k == RETURN_DISPOSITION_KEY
 #   endif
+#   if SUPPORT_SEGREGATED_ALLOC
+            || k == SLAB_CACHE_DIRECT_KEY
+#   endif
+#   if ISA_HAS_BIASED_RC_BIT
+            || k == RC_BIAS_DIRECT_KEY
+#   endif
+            || k == PENDING_RELEASE_KEY
+            || k == RC_PROFILE_KEY
+            || k == PROPERTY_HAZARD_KEY
                );
 }
 
@@ -924,6 +942,16 @@ class monitor_tt {
         if (err) _objc_fatal("pthread_cond_wait failed (%d)", err);
     }
 
+    // Wait on some condition other than the monitor's own, 
+    // which must only be waited on with this monitor entered.
+    void wait(pthread_cond_t& otherCond) 
+    {
+        lockdebug_monitor_wait(this);
+
+        int err = pthread_cond_wait(&otherCond, &mutex);
+        if (err) _objc_fatal("pthread_cond_wait failed (%d)", err);
+    }
+
     void notify() 
     {
         int err = pthread_cond_signal(&cond);
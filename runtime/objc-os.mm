@@ -460,6 +460,8 @@ map_images_nolock(unsigned mhCount, const char * const mhPaths[],
     uint32_t hCount;
     size_t selrefCount = 0;
 
+    objc::TraceScope trace("images", "map_images");
+
     // Perform first-time initialization if necessary.
     // This function is called before ordinary library initializers. 
     // fixme defer initialization until an objc-using image is found?
@@ -700,6 +702,7 @@ static void defineLockOrder()
     lockdebug_lock_precedes_lock(&impLock, &crashlog_lock);
 #endif
     lockdebug_lock_precedes_lock(&selLock, &crashlog_lock);
+    lockdebug_lock_precedes_lock(&InternedStringLock, &crashlog_lock);
 #if CONFIG_USE_CACHE_LOCK
     lockdebug_lock_precedes_lock(&cacheUpdateLock, &crashlog_lock);
 #endif
@@ -710,6 +713,7 @@ static void defineLockOrder()
     PropertyLocks.precedeLock(&crashlog_lock);
     StructLocks.precedeLock(&crashlog_lock);
     CppObjectLocks.precedeLock(&crashlog_lock);
+    RCCounterLocks.precedeLock(&crashlog_lock);
 
     // loadMethodLock precedes everything
     // because it is held while +load methods run
@@ -724,6 +728,7 @@ static void defineLockOrder()
     lockdebug_lock_precedes_lock(&loadMethodLock, &impLock);
 #endif
     lockdebug_lock_precedes_lock(&loadMethodLock, &selLock);
+    lockdebug_lock_precedes_lock(&loadMethodLock, &InternedStringLock);
 #if CONFIG_USE_CACHE_LOCK
     lockdebug_lock_precedes_lock(&loadMethodLock, &cacheUpdateLock);
 #endif
@@ -734,6 +739,7 @@ static void defineLockOrder()
     PropertyLocks.succeedLock(&loadMethodLock);
     StructLocks.succeedLock(&loadMethodLock);
     CppObjectLocks.succeedLock(&loadMethodLock);
+    RCCounterLocks.succeedLock(&loadMethodLock);
 
     // PropertyLocks and CppObjectLocks and AssociationManagerLock 
     // precede everything because they are held while objc_retain() 
@@ -755,6 +761,7 @@ static void defineLockOrder()
 #endif
     PropertyAndCppObjectAndAssocLocksPrecedeLock(&classInitLock);
     PropertyAndCppObjectAndAssocLocksPrecedeLock(&selLock);
+    PropertyAndCppObjectAndAssocLocksPrecedeLock(&InternedStringLock);
 #if CONFIG_USE_CACHE_LOCK
     PropertyAndCppObjectAndAssocLocksPrecedeLock(&cacheUpdateLock);
 #endif
@@ -767,6 +774,9 @@ static void defineLockOrder()
 
     PropertyLocks.precedeLock(&AssociationsManagerLock);
     CppObjectLocks.precedeLock(&AssociationsManagerLock);
+
+    // RCCounterLocks are taken inside SideTable locks.
+    SideTableLocksPrecedeLocks(RCCounterLocks);
     
 #if __OBJC2__
     lockdebug_lock_precedes_lock(&classInitLock, &runtimeLock);
@@ -783,6 +793,7 @@ static void defineLockOrder()
     lockdebug_lock_precedes_lock(&runtimeLock, &cacheUpdateLock);
 #endif
     lockdebug_lock_precedes_lock(&runtimeLock, &DemangleCacheLock);
+    lockdebug_lock_precedes_lock(&runtimeLock, &InternedStringLock);
 #else
     // Runtime operations may occur inside SideTable locks
     // (such as storeWeak calling getMethodImplementation)
@@ -796,6 +807,7 @@ static void defineLockOrder()
 #endif
     lockdebug_lock_precedes_lock(&methodListLock, &impLock);
     lockdebug_lock_precedes_lock(&classLock, &selLock);
+    lockdebug_lock_precedes_lock(&classLock, &InternedStringLock);
     lockdebug_lock_precedes_lock(&classLock, &cacheUpdateLock);
 #endif
 
@@ -804,6 +816,7 @@ static void defineLockOrder()
     PropertyLocks.defineLockOrder();
     StructLocks.defineLockOrder();
     CppObjectLocks.defineLockOrder();
+    RCCounterLocks.defineLockOrder();
 }
 // LOCKDEBUG
 #endif
@@ -822,6 +835,7 @@ void _objc_atfork_prepare()
     CppObjectLocks.lockAll();
     AssociationsManagerLock.lock();
     SideTableLockAll();
+    RCCounterLocks.lockAll();
     classInitLock.enter();
 #if __OBJC2__
     runtimeLock.lock();
@@ -833,6 +847,7 @@ void _objc_atfork_prepare()
     impLock.lock();
 #endif
     selLock.lock();
+    InternedStringLock.lock();
 #if CONFIG_USE_CACHE_LOCK
     cacheUpdateLock.lock();
 #endif
@@ -861,6 +876,8 @@ void _objc_atfork_parent()
     cacheUpdateLock.unlock();
 #endif
     selLock.unlock();
+    InternedStringLock.unlock();
+    RCCounterLocks.unlockAll();
     SideTableUnlockAll();
 #if __OBJC2__
     DemangleCacheLock.unlock();
@@ -888,6 +905,7 @@ void _objc_atfork_child()
     CppObjectLocks.forceResetAll();
     StructLocks.forceResetAll();
     PropertyLocks.forceResetAll();
+    objc::propertyHazardsForkChild();
     AssociationsManagerLock.forceReset();
     AltHandlerDebugLock.forceReset();
     objcMsgLogLock.forceReset();
@@ -897,6 +915,8 @@ void _objc_atfork_child()
     cacheUpdateLock.forceReset();
 #endif
     selLock.forceReset();
+    InternedStringLock.forceReset();
+    RCCounterLocks.forceResetAll();
     SideTableForceResetAll();
 #if __OBJC2__
     DemangleCacheLock.forceReset();
@@ -908,6 +928,7 @@ void _objc_atfork_child()
     classLock.forceReset();
 #endif
     classInitLock.forceReset();
+    _initializeWaitQueuesForceReset();
 
     lockdebug_assert_no_locks_locked();
 }
@@ -102,6 +102,15 @@ public:
         extra_rc = 0;
         has_sidetable_rc = 0;
     }
+    // Whether retain counts beyond extra_rc may be 
+    // kept in an out-of-line counter (OBJC_OUT_OF_LINE_RC).
+    bool canUseRCCounter() {
+# if ISA_HAS_BIASED_RC_BIT
+        return nonpointer && !biased_rc;
+# else
+        return nonpointer;
+# endif
+    }
 #endif
 
     void setClass(Class cls, objc_object *obj);
@@ -176,7 +185,18 @@ public:
     // Implementation of dealloc methods
     bool rootIsDeallocating();
     void clearDeallocating();
+    void clearDeallocating_nolock(SideTable& table);
+    bool hasSideTableEntries();
+    bool canFreeWithoutDestruct();
+    bool canFreeAfterCxxDestruct();
     void rootDealloc();
+    bool canDeferRelease(uintptr_t parked);
+
+#if ISA_HAS_BIASED_RC_BIT
+    // Deferred retain counts owned by the allocating thread
+    void initBiasedRC();
+    bool rootMergeBias(uintptr_t bias);
+#endif
 
 private:
     void initIsa(Class newCls, bool nonpointer, bool hasCxxDtor);
@@ -202,6 +222,8 @@ private:
     inline bool rootRelease(bool performDealloc, RRVariant variant);
     id rootRetain_overflow(bool tryRetain);
     uintptr_t rootRelease_underflow(bool performDealloc);
+    id rootRetain_counter(bool tryRetain);
+    bool rootRelease_counter(bool performDealloc);
 
     void clearDeallocating_slow();
 
@@ -220,6 +242,14 @@ private:
     void sidetable_clearExtraRC_nolock();
 #endif
 
+#if ISA_HAS_BIASED_RC_BIT
+    bool sidetable_addBiasDebt_nolock(isa_t oldisa);
+    size_t sidetable_takeBiasDebt_nolock();
+    void sidetable_detachBias_nolock();
+    bool sidetable_addDetachedBiasDebt_nolock();
+    bool sidetable_mergeBias_nolock(uintptr_t bias);
+#endif
+
     // Side-table-only retain count
     bool sidetable_isDeallocating();
     void sidetable_clearDeallocating();
@@ -580,6 +610,7 @@ extern bool didCallDyldNotifyRegister;
 /* selectors */
 extern void sel_init(size_t selrefCount);
 extern SEL sel_registerNameNoLock(const char *str, bool copy);
+extern SEL sel_lookUpNameNoLock(const char *str);
 
 extern SEL SEL_cxx_construct;
 extern SEL SEL_cxx_destruct;
@@ -715,6 +746,7 @@ typedef struct {
     const char **classNameLookups;  // for objc_getClass() hooks
     unsigned classNameLookupsAllocated;
     unsigned classNameLookupsUsed;
+    struct TrampolineCache *trampolineCache;  // for imp_implementationWithBlock
 
     // If you add new fields here, don't forget to update 
     // _objc_pthread_destroyspecific()
@@ -743,6 +775,7 @@ extern id objc_autoreleaseReturnValue(id obj);
 // block trampolines
 extern void _imp_implementationWithBlock_init(void);
 extern IMP _imp_implementationWithBlockNoCopy(id block);
+extern void _destroyTrampolineCache(struct TrampolineCache *cache);
 
 // layout.h
 typedef struct {
@@ -785,7 +818,7 @@ extern const header_info *_headerForClass(Class cls);
 extern Class _class_remap(Class cls);
 extern Ivar _class_getVariable(Class cls, const char *name);
 
-extern unsigned _class_createInstancesFromZone(Class cls, size_t extraBytes, void *zone, id *results, unsigned num_requested);
+extern unsigned _class_createInstancesFromZone(Class cls, size_t extraBytes, void *zone, id *results, unsigned num_requested, int construct_flags = 0);
 
 extern const char *_category_getName(Category cat);
 extern const char *_category_getClassName(Category cat);
@@ -796,10 +829,27 @@ enum {
     OBJECT_CONSTRUCT_NONE = 0,
     OBJECT_CONSTRUCT_FREE_ONFAILURE = 1,
     OBJECT_CONSTRUCT_CALL_BADALLOC = 2,
+    OBJECT_CONSTRUCT_DEFAULT_ALLOC = 4,  // default +alloc: may use slabs, deferred RC
 };
 extern id object_cxxConstructFromClass(id obj, Class cls, int flags);
+extern unsigned object_cxxConstructBatchFromClass(id *objs, unsigned count, Class cls);
 extern void object_cxxDestruct(id obj);
 
+namespace objc {
+// .cxx_construct or .cxx_destruct IMPs for a class and its superclasses,
+// in calling order.
+struct cxx_chain_t {
+    uint32_t count;
+    struct {
+        Class cls;
+        IMP imp;
+    } entries[0];
+};
+extern const cxx_chain_t *cxxConstructChain(Class cls);
+extern const cxx_chain_t *cxxDestructChain(Class cls);
+extern void cxxChainsPrepare(Class cls);
+}
+
 extern void fixupCopiedIvars(id newObject, id oldObject);
 extern Class _class_getClassForIvar(Class cls, Ivar ivar);
 
@@ -886,6 +936,48 @@ inline void operator delete[](void* p, const std::nothrow_t&) noexcept(true) { f
 #endif
 
 
+#include "objc-trace.h"
+#include "objc-rcprofile.h"
+#include "objc-slab.h"
+
+#if SUPPORT_NONPOINTER_ISA
+namespace objc {
+
+// Out-of-line retain counts (OBJC_OUT_OF_LINE_RC). See NSObject.mm.
+extern void rcCounterInit(void);
+extern bool rcCounterExists(objc_object *obj);
+extern bool rcCounterInstall(objc_object *obj, size_t count);
+extern size_t rcCounterTake(objc_object *obj);
+extern bool rcCounterRetainCount(objc_object *obj, uintptr_t *outCount);
+
+} // namespace objc
+#endif
+
+#if ISA_HAS_BIASED_RC_BIT
+namespace objc {
+
+// Deferred retain counts (OBJC_DEFERRED_RC). See NSObject.mm.
+enum class RCBiasRelease { NotOwner, Released, Dealloc };
+
+extern void rcBiasInit(void);
+extern void rcBiasAdopt(objc_object *obj);
+extern bool rcBiasRetain(objc_object *obj);
+extern RCBiasRelease rcBiasRelease(objc_object *obj);
+extern uintptr_t rcBiasRetainCount_nolock(objc_object *obj, uintptr_t rc);
+extern bool rcBiasRelinquish(objc_object *obj);
+extern void rcBiasFlush(void);
+
+} // namespace objc
+#endif
+
+namespace objc {
+
+// Lock-free atomic properties. See objc-accessors.mm.
+extern void propertyHazardsInit(void);
+extern void propertyHazardsForkChild(void);
+
+} // namespace objc
+
 class TimeLogger {
     uint64_t mStart;
     bool mRecord;
@@ -896,9 +988,14 @@ class TimeLogger {
     { }
 
     void log(const char *msg) {
-        if (mRecord) {
+        if (mRecord  ||  slowpath(RecordTrace)) {
             uint64_t end = nanoseconds();
-            _objc_inform("%.2f ms: %s", (end - mStart) / 1000000.0, msg);
+            if (mRecord) {
+                _objc_inform("%.2f ms: %s", (end - mStart) / 1000000.0, msg);
+            }
+            if (RecordTrace) {
+                objc::traceRecord("images", msg, mStart, end);
+            }
             mStart = nanoseconds();
         }
     }
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2021 Apple Inc.  All Rights Reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/**
+ * @file objc-rcprofile.h
+ *
+ * Retain count profiling for objc.
+ *
+ * When OBJC_PROFILE_RC is set, one in RCProfileSamplePeriod retains and
+ * releases on each thread is recorded with the object's class. Every
+ * extra_rc overflow, extra_rc underflow that borrows retain counts back,
+ * and deallocation that cannot simply free the object is recorded too.
+ * Records collect in a per-thread buffer and are added to per-class
+ * totals when it fills. _objc_copyRCProfile() reports the totals.
+ *
+ * Included by objc-private.h.
+ */
+
+#ifndef _OBJC_RCPROFILE_H
+#define _OBJC_RCPROFILE_H
+
+namespace objc {
+
+enum RCProfileEvent : uint8_t {
+    RCProfileRetain,            // sampled
+    RCProfileRelease,           // sampled
+    RCProfileOverflow,          // extra_rc overflowed
+    RCProfileBorrow,            // extra_rc underflowed with counts elsewhere
+    RCProfileDeallocWeak,       // slow dealloc: weakly referenced
+    RCProfileDeallocAssoc,      // slow dealloc: associated objects
+    RCProfileDeallocCxxDtor,    // slow dealloc: C++ destructors
+    RCProfileDeallocSideTable,  // slow dealloc: side table retain count
+    RCProfileEventCount
+};
+
+static constexpr unsigned RCProfileSamplePeriod = 64;
+
+extern void rcProfileInit(void);
+extern void rcProfileRecord(objc_object *obj, RCProfileEvent event);
+extern void rcProfileSample(objc_object *obj, RCProfileEvent event);
+extern void rcProfileDealloc(objc_object *obj);
+
+} // namespace objc
+
+#endif
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2021 Apple Inc.  All Rights Reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/***********************************************************************
+* objc-rcprofile.mm
+* Per-thread sample buffers and per-class retain count profile totals.
+**********************************************************************/
+
+#include "objc-private.h"
+#include "objc-object.h"
+
+#include <atomic>
+
+namespace objc {
+
+static constexpr unsigned RCProfileBufferCount = 256;
+
+struct RCProfileRecord {
+    Class cls;
+    RCProfileEvent event;
+};
+
+struct RCProfileBuffer {
+    // Retains and releases until the next sample of each. Separate
+    // countdowns keep alternating retains and releases from aliasing.
+    unsigned countdown[RCProfileRelease + 1];
+    unsigned count;
+    RCProfileRecord records[RCProfileBufferCount];
+};
+
+// Must be a power of two. Classes that find no free slot are not counted.
+static constexpr unsigned RCProfileClassCount = 2048;
+static constexpr unsigned RCProfileProbes = 32;
+
+struct RCProfileClass {
+    std::atomic<Class> cls;
+    std::atomic<uint64_t> counts[RCProfileEventCount];
+};
+
+static std::atomic<RCProfileClass *> rcProfileClasses;
+
+static RCProfileClass *rcProfileClassesIfNeeded()
+{
+    RCProfileClass *classes =
+        rcProfileClasses.load(std::memory_order_acquire);
+    if (slowpath(!classes)) {
+        RCProfileClass *newClasses = (RCProfileClass *)
+            calloc(RCProfileClassCount, sizeof(RCProfileClass));
+        if (rcProfileClasses.compare_exchange_strong(classes, newClasses,
+                                                     std::memory_order_acq_rel))
+        {
+            classes = newClasses;
+        } else {
+            free(newClasses);
+        }
+    }
+    return classes;
+}
+
+static RCProfileClass *rcProfileClassFor(RCProfileClass *classes, Class cls)
+{
+    uintptr_t hash = (uintptr_t)cls >> 3;
+    for (unsigned i = 0; i < RCProfileProbes; i++) {
+        RCProfileClass *entry =
+            &classes[(hash + i) & (RCProfileClassCount - 1)];
+        Class entryCls = entry->cls.load(std::memory_order_relaxed);
+        if (entryCls == cls) return entry;
+        if (!entryCls  &&
+            entry->cls.compare_exchange_strong(entryCls, cls,
+                                               std::memory_order_relaxed))
+        {
+            return entry;
+        }
+        // Another thread may have claimed the slot for cls.
+        if (entryCls == cls) return entry;
+    }
+    return nil;
+}
+
+// Adds the buffer's records to the per-class totals and empties it.
+static void rcProfileFlush(RCProfileBuffer *buffer)
+{
+    RCProfileClass *classes = rcProfileClassesIfNeeded();
+    for (unsigned i = 0; i < buffer->count; i++) {
+        RCProfileRecord& record = buffer->records[i];
+        uint64_t amount = (record.event == RCProfileRetain  ||
+                           record.event == RCProfileRelease)
+            ? RCProfileSamplePeriod : 1;
+        if (RCProfileClass *entry = rcProfileClassFor(classes, record.cls)) {
+            entry->counts[record.event].fetch_add(amount,
+                                                  std::memory_order_relaxed);
+        }
+    }
+    buffer->count = 0;
+}
+
+static void rcProfileBufferDestroy(void *arg)
+{
+    auto *buffer = (RCProfileBuffer *)arg;
+    if (!buffer) return;
+    rcProfileFlush(buffer);
+    free(buffer);
+}
+
+static RCProfileBuffer *rcProfileBuffer()
+{
+    auto *buffer = (RCProfileBuffer *)tls_get_direct(RC_PROFILE_KEY);
+    if (slowpath(!buffer)) {
+        buffer = (RCProfileBuffer *)calloc(1, sizeof(*buffer));
+        buffer->countdown[RCProfileRetain] = RCProfileSamplePeriod;
+        buffer->countdown[RCProfileRelease] = RCProfileSamplePeriod;
+        tls_set_direct(RC_PROFILE_KEY, buffer);
+    }
+    return buffer;
+}
+
+void rcProfileInit(void)
+{
+    int r __unused = pthread_key_init_np(RC_PROFILE_KEY,
+                                         &rcProfileBufferDestroy);
+    ASSERT(r == 0);
+}
+
+// Records one event for obj's class.
+NEVER_INLINE void rcProfileRecord(objc_object *obj, RCProfileEvent event)
+{
+    RCProfileBuffer *buffer = rcProfileBuffer();
+    buffer->records[buffer->count++] = { obj->ISA(), event };
+    if (buffer->count == RCProfileBufferCount) rcProfileFlush(buffer);
+}
+
+// Records one in RCProfileSamplePeriod retains or releases on each thread.
+NEVER_INLINE void rcProfileSample(objc_object *obj, RCProfileEvent event)
+{
+    ASSERT(event == RCProfileRetain  ||  event == RCProfileRelease);
+    RCProfileBuffer *buffer = rcProfileBuffer();
+    if (--buffer->countdown[event]) return;
+    buffer->countdown[event] = RCProfileSamplePeriod;
+    rcProfileRecord(obj, event);
+}
+
+// Records why obj cannot simply be freed.
+NEVER_INLINE void rcProfileDealloc(objc_object *obj)
+{
+#if SUPPORT_NONPOINTER_ISA
+    isa_t bits = obj->isaBits();
+    if (!bits.nonpointer) return;
+    if (bits.weakly_referenced) rcProfileRecord(obj, RCProfileDeallocWeak);
+    if (bits.has_assoc) rcProfileRecord(obj, RCProfileDeallocAssoc);
+    if (obj->ISA()->hasCxxDtor()) rcProfileRecord(obj, RCProfileDeallocCxxDtor);
+    if (bits.has_sidetable_rc) rcProfileRecord(obj, RCProfileDeallocSideTable);
+#else
+    (void)obj;
+#endif
+}
+
+} // namespace objc
+
+using namespace objc;
+
+
+/***********************************************************************
+* _objc_copyRCProfile
+* Returns the per-class retain count profile, busiest classes first.
+* Sampled retains and releases are scaled up by the sample period.
+* Other threads' most recent records may not be included yet.
+* Locking: none
+**********************************************************************/
+objc_rc_profile_entry *
+_objc_copyRCProfile(unsigned int *outCount)
+{
+    if (outCount) *outCount = 0;
+    if (!ProfileRC) return nil;
+
+    rcProfileFlush(rcProfileBuffer());
+    RCProfileClass *classes = rcProfileClassesIfNeeded();
+
+    unsigned count = 0;
+    for (unsigned i = 0; i < RCProfileClassCount; i++) {
+        if (classes[i].cls.load(std::memory_order_relaxed)) count++;
+    }
+
+    auto *result = (objc_rc_profile_entry *)
+        calloc(count + 1, sizeof(objc_rc_profile_entry));
+    unsigned n = 0;
+    for (unsigned i = 0; i < RCProfileClassCount  &&  n < count; i++) {
+        RCProfileClass& entry = classes[i];
+        Class cls = entry.cls.load(std::memory_order_relaxed);
+        if (!cls) continue;
+
+        auto load = [&](RCProfileEvent event) {
+            return entry.counts[event].load(std::memory_order_relaxed);
+        };
+        objc_rc_profile_entry& out = result[n++];
+        out.cls = cls;
+        out.retains = load(RCProfileRetain);
+        out.releases = load(RCProfileRelease);
+        out.overflows = load(RCProfileOverflow);
+        out.borrows = load(RCProfileBorrow);
+        out.weakDeallocs = load(RCProfileDeallocWeak);
+        out.assocDeallocs = load(RCProfileDeallocAssoc);
+        out.cxxDtorDeallocs = load(RCProfileDeallocCxxDtor);
+        out.sideTableDeallocs = load(RCProfileDeallocSideTable);
+    }
+
+    qsort(result, n, sizeof(result[0]), [](const void *a, const void *b) {
+        auto *ea = (const objc_rc_profile_entry *)a;
+        auto *eb = (const objc_rc_profile_entry *)b;
+        uint64_t ta = ea->retains + ea->releases;
+        uint64_t tb = eb->retains + eb->releases;
+        return ta > tb ? -1 : ta < tb ? 1 : 0;
+    });
+
+    if (outCount) *outCount = n;
+    return result;
+}
@@ -80,8 +80,9 @@
 #define RW_CONSTRUCTING       (1<<26)
 // class allocated and registered
 #define RW_CONSTRUCTED        (1<<25)
-// available for use; was RW_FINALIZE_ON_MAIN_THREAD
-// #define RW_24 (1<<24)
+// class and superclasses use NSObject's -dealloc (see DeallocScanner)
+// was RW_FINALIZE_ON_MAIN_THREAD
+#define RW_HAS_DEFAULT_DEALLOC (1<<24)
 // class +load has been called
 #define RW_LOADED             (1<<23)
 #if !SUPPORT_NONPOINTER_ISA
@@ -484,6 +485,7 @@ public:
     void copyCacheNolock(objc_imp_cache_entry *buffer, int len);
     void destroy();
     void eraseNolock(const char *func);
+    void eraseSelectorsNolock(const SEL *sels, uint32_t count, const char *func);
 
     static void init();
     static void collectNolock(bool collectALot);
@@ -1448,6 +1450,51 @@ class protocol_array_t :
     protocol_array_t(protocol_list_t *l) : Super(l) { }
 };
 
+
+/***********************************************************************
+* method_index_t
+* Merged selector -> method index over all of a class's method lists.
+*
+* Classes with many categories have one method list per category, and
+* an uncached lookup binary-searches each of them in turn. For those
+* classes the runtime lazily builds a single array sorted by selector
+* address. Only the first method for each selector (in method list
+* order) is kept, so category overrides behave exactly as they do
+* when searching the lists one by one.
+*
+* The index is discarded whenever the class's method lists change.
+* Locking: runtimeLock must be held to build, search or free an index.
+**********************************************************************/
+struct method_index_t {
+    // Classes with fewer method lists than this are searched list by list.
+    static constexpr uint32_t minLists = 8;
+
+    struct entry_t {
+        SEL name;
+        method_t *meth;
+    };
+
+    uint32_t count;
+    entry_t entries[0];
+
+    static size_t byteSize(uint32_t count) {
+        return sizeof(method_index_t) + count*sizeof(entries[0]);
+    }
+
+    method_t *find(SEL sel) const {
+        const entry_t *base = entries;
+        for (uint32_t n = count; n != 0; n >>= 1) {
+            const entry_t *probe = base + (n >> 1);
+            if (probe->name == sel) return probe->meth;
+            if ((uintptr_t)sel > (uintptr_t)probe->name) {
+                base = probe + 1;
+                n--;
+            }
+        }
+        return nil;
+    }
+};
+
 struct class_rw_ext_t {
     DECLARE_AUTHED_PTR_TEMPLATE(class_ro_t)
     class_ro_t_authed_ptr<const class_ro_t> ro;
@@ -1456,6 +1503,7 @@ struct class_rw_ext_t {
     protocol_array_t protocols;
     char *demangledName;
     uint32_t version;
+    method_index_t *methodIndex;
 };
 
 struct class_rw_t {
@@ -1822,6 +1870,16 @@ struct objc_class : objc_object {
     }
 #endif
 
+    bool hasCustomDealloc() const {
+        return !(bits.data()->flags & RW_HAS_DEFAULT_DEALLOC);
+    }
+    void setHasDefaultDealloc() {
+        bits.data()->setFlags(RW_HAS_DEFAULT_DEALLOC);
+    }
+    void setHasCustomDealloc() {
+        bits.data()->clearFlags(RW_HAS_DEFAULT_DEALLOC);
+    }
+
 #if FAST_CACHE_HAS_CXX_CTOR
     bool hasCxxCtor() {
         ASSERT(isRealized());
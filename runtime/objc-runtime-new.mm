@@ -47,8 +47,11 @@ static void adjustCustomFlagsForMethodChange(Class cls, method_t *meth);
 static method_t *search_method_list(const method_list_t *mlist, SEL sel);
 template<typename T> static bool method_lists_contains_any(T *mlists, T *end,
         SEL sels[], size_t selcount);
-static void flushCaches(Class cls, const char *func, bool (^predicate)(Class c));
+static void flushCaches(Class cls, const char *func, bool (^predicate)(Class c),
+                        const SEL *sels = nil, uint32_t selCount = 0);
 static void initializeTaggedPointerObfuscator(void);
+static void cxxChainsErase_nolock(Class cls);
+static void cxxChainsFree_nolock(Class cls);
 #if SUPPORT_FIXUP
 static void fixupMessageRef(message_ref_t *msg);
 #endif
@@ -64,9 +67,47 @@ enum {
     ATTACH_METACLASS           = 1 << 1,
     ATTACH_CLASS_AND_METACLASS = 1 << 2,
     ATTACH_EXISTING            = 1 << 3,
+    ATTACH_DEFER_FLUSH         = 1 << 4,   // caller flushes caches itself
 };
 static void attachCategories(Class cls, const struct locstamped_category_t *cats_list, uint32_t cats_count, int flags);
 
+// The selectors of some method lists, sorted and uniqued, 
+// for a selector-scoped flushCaches().
+class flush_selectors_t : nocopy_t {
+    SEL *_sels = nil;
+    uint32_t _count = 0;
+    uint32_t _capacity = 0;
+    bool _sorted = true;
+
+public:
+    ~flush_selectors_t() { free(_sels); }
+
+    void add(SEL sel) {
+        if (_count == _capacity) {
+            _capacity = _capacity ? _capacity * 2 : 16;
+            _sels = (SEL *)reallocf(_sels, _capacity * sizeof(SEL));
+        }
+        if (_count  &&  sel <= _sels[_count - 1]) _sorted = false;
+        _sels[_count++] = sel;
+    }
+
+    void add(const method_list_t *mlist);
+
+    const SEL *sels() {
+        if (!_sorted) {
+            std::sort(_sels, _sels + _count);
+            _count = (uint32_t)(std::unique(_sels, _sels + _count) - _sels);
+            _sorted = true;
+        }
+        return _sels;
+    }
+
+    uint32_t count() {
+        sels();
+        return _count;
+    }
+};
+
 
 /***********************************************************************
 * Lock management
@@ -742,6 +783,7 @@ enum SelectorBundle {
     AWZ,
     RR,
     Core,
+    Dealloc,
 };
 
 namespace scanner {
@@ -770,6 +812,7 @@ printCustom(Class cls, SelectorBundle bundle, bool inherited)
         [AWZ]  = "CUSTOM AWZ",
         [RR]   = "CUSTOM RR",
         [Core] = "CUSTOM Core",
+        [Dealloc] = "CUSTOM DEALLOC",
     };
 
     _objc_inform("%s: %s%s%s", SelectorBundleName[bundle],
@@ -1094,6 +1137,31 @@ struct CoreScanner : scanner::Mixin<CoreScanner, Core, PrintCustomCore> {
     }
 };
 
+// -dealloc.
+// Instances of classes whose -dealloc is NSObject's are freed by
+// the runtime, so they may live in slab memory and 
+// objc_releaseObjects() may deallocate them without sending -dealloc.
+// Swift classes are always custom: Swift frees their instances itself.
+struct DeallocScanner : scanner::Mixin<DeallocScanner, Dealloc, PrintCustomDealloc, scanner::Scope::Instances> {
+    static bool isCustom(Class cls) {
+        return cls->hasCustomDealloc();
+    }
+    static void setCustom(Class cls) {
+        cls->setHasCustomDealloc();
+    }
+    static void setDefault(Class cls) {
+        if (!cls->isAnySwift()) cls->setHasDefaultDealloc();
+    }
+    static bool isInterestingSelector(SEL sel) {
+        return sel == @selector(dealloc);
+    }
+    template <typename T>
+    static bool scanMethodLists(T *mlists, T *end) {
+        SEL sels[1] = { @selector(dealloc) };
+        return method_lists_contains_any(mlists, end, sels, 1);
+    }
+};
+
 class category_list : nocopy_t {
     union {
         locstamped_category_t lc;
@@ -1256,15 +1324,15 @@ static bool isBundleClass(Class cls)
 
 
 static void 
-fixupMethodList(method_list_t *mlist, bool bundleCopy, bool sort)
+fixupMethodList(method_list_t *mlist, bool bundleCopy, bool sort,
+                bool selLockHeld = false)
 {
     runtimeLock.assertLocked();
     ASSERT(!mlist->isFixedUp());
 
-    // fixme lock less in attachMethodLists ?
     // dyld3 may have already uniqued, but not sorted, the list
     if (!mlist->isUniqued()) {
-        mutex_locker_t lock(selLock);
+        conditional_mutex_locker_t lock(selLock, !selLockHeld);
     
         // Unique selectors in list.
         for (auto& meth : *mlist) {
@@ -1290,6 +1358,24 @@ fixupMethodList(method_list_t *mlist, bool bundleCopy, bool sort)
 }
 
 
+/***********************************************************************
+* invalidateMethodIndex
+* Discards cls's merged method index, if any. 
+* It is rebuilt on the next uncached lookup.
+* Locking: runtimeLock must be held by the caller
+**********************************************************************/
+static void invalidateMethodIndex(Class cls)
+{
+    runtimeLock.assertLocked();
+
+    auto rwe = cls->data()->ext();
+    if (rwe  &&  rwe->methodIndex) {
+        free(rwe->methodIndex);
+        rwe->methodIndex = nil;
+    }
+}
+
+
 static void 
 prepareMethodLists(Class cls, method_list_t **addedLists, int addedCount,
                    bool baseMethods, bool methodsFromBundle, const char *why)
@@ -1298,6 +1384,10 @@ prepareMethodLists(Class cls, method_list_t **addedLists, int addedCount,
 
     if (addedCount == 0) return;
 
+    // The caller is about to attach these lists, 
+    // which makes any merged method index stale.
+    invalidateMethodIndex(cls);
+
     // There exist RR/AWZ/Core special cases for some class's base methods.
     // But this code should never need to scan base methods for RR/AWZ/Core:
     // default RR/AWZ/Core cannot be set before setInitialized().
@@ -1337,6 +1427,7 @@ prepareMethodLists(Class cls, method_list_t **addedLists, int addedCount,
         objc::AWZScanner::scanAddedMethodLists(cls, addedLists, addedCount);
         objc::RRScanner::scanAddedMethodLists(cls, addedLists, addedCount);
         objc::CoreScanner::scanAddedMethodLists(cls, addedLists, addedCount);
+        objc::DeallocScanner::scanAddedMethodLists(cls, addedLists, addedCount);
     }
 }
 
@@ -1450,12 +1541,17 @@ attachCategories(Class cls, const locstamped_category_t *cats_list, uint32_t cat
         prepareMethodLists(cls, mlists + ATTACH_BUFSIZ - mcount, mcount,
                            NO, fromBundle, __func__);
         rwe->methods.attachLists(mlists + ATTACH_BUFSIZ - mcount, mcount);
-        if (flags & ATTACH_EXISTING) {
+        if ((flags & ATTACH_EXISTING) && !(flags & ATTACH_DEFER_FLUSH)) {
+            flush_selectors_t sels;
+            for (uint32_t i = 0; i < cats_count; i++) {
+                method_list_t *mlist = cats_list[i].cat->methodsForMeta(isMeta);
+                if (mlist) sels.add(mlist);
+            }
             flushCaches(cls, __func__, [](Class c){
                 // constant caches have been dealt with in prepareMethodLists
                 // if the class still is constant here, it's fine to keep
                 return !c->cache.isConstantOptimizedCache();
-            });
+            }, sels.sels(), sels.count());
         }
     }
 
@@ -2300,6 +2396,7 @@ static void addSubclass(Class supercls, Class subcls)
         objc::AWZScanner::scanAddedSubClass(subcls, supercls);
         objc::RRScanner::scanAddedSubClass(subcls, supercls);
         objc::CoreScanner::scanAddedSubClass(subcls, supercls);
+        objc::DeallocScanner::scanAddedSubClass(subcls, supercls);
 
         if (!supercls->allowsPreoptCaches()) {
             subcls->setDisallowPreoptCachesRecursively(__func__);
@@ -2636,6 +2733,8 @@ static Class realizeClassWithoutSwift(Class cls, Class previously)
         cls->setData(rw);
     }
 
+    objc::TraceScope trace("class", [&]{ return ro->getName(); });
+
     cls->cache.initializeToEmptyOrPreoptimizedInDisguise();
 
 #if FAST_CACHE_META
@@ -3050,22 +3149,230 @@ BOOL _class_isSwift(Class _Nullable cls)
 }
 
 /***********************************************************************
-* _objc_flush_caches
-* Flushes all caches.
-* (Historical behavior: flush caches for cls, its metaclass, 
-* and subclasses thereof. Nil flushes all classes.)
-* Locking: acquires runtimeLock
+* negativeLookupFilters
+* Per-class Bloom filters over the selectors implemented by a class 
+* and all of its superclasses.
+*
+* A selector that is not in a class's filter is definitely not
+* implemented anywhere in its hierarchy, so lookUpImpOrForward can go
+* straight to the resolver and forwarding without walking any method
+* lists. respondsToSelector: probes for optional methods are the usual
+* source of such misses.
+*
+* Filters are built only with OBJC_NEGATIVE_LOOKUP_FILTER set. A class 
+* gets a filter after negativeLookupBuildThreshold misses. Every method 
+* addition, category attachment and superclass change goes through 
+* flushCaches. A flush scoped to some selectors adds them to the 
+* affected filters, so the filters stay supersets of the implemented 
+* selectors. An unscoped flush discards the affected filters.
+*
+* Locking: runtimeLock must be held when accessing this map.
+**********************************************************************/
+namespace objc {
+
+struct selector_filter_t {
+    static constexpr uint32_t maxBits = 1 << 16;
+
+    uint32_t mask;      // bit count - 1
+    uint64_t words[0];
+
+    static uint64_t hash(SEL sel) {
+        uint64_t h = (uint64_t)(uintptr_t)sel * 0x9E3779B97F4A7C15ULL;
+        return h ^ (h >> 29);
+    }
+
+    void add(SEL sel) {
+        uint64_t h = hash(sel);
+        uint32_t b1 = (uint32_t)h & mask, b2 = (uint32_t)(h >> 32) & mask;
+        words[b1 / 64] |= 1ULL << (b1 % 64);
+        words[b2 / 64] |= 1ULL << (b2 % 64);
+    }
+
+    bool mayContain(SEL sel) const {
+        uint64_t h = hash(sel);
+        uint32_t b1 = (uint32_t)h & mask, b2 = (uint32_t)(h >> 32) & mask;
+        return (words[b1 / 64] & (1ULL << (b1 % 64)))  &&
+               (words[b2 / 64] & (1ULL << (b2 % 64)));
+    }
+};
+
+struct negative_lookup_entry_t {
+    uint32_t misses;
+    selector_filter_t *filter;
+};
+
+static constexpr uint32_t negativeLookupBuildThreshold = 4;
+
+static objc::LazyInitDenseMap<Class, negative_lookup_entry_t> negativeLookupFilters;
+
+}
+
+static objc::selector_filter_t *
+buildSelectorFilter(Class cls)
+{
+    runtimeLock.assertLocked();
+
+    uint32_t count = 0;
+    for (Class c = cls; c; c = c->getSuperclass()) {
+        count += c->data()->methods().count();
+    }
+
+    // About 8 bits per selector keeps false positives around 5%.
+    uint32_t bits = 64;
+    while (bits < count * 8  &&  bits < objc::selector_filter_t::maxBits) {
+        bits <<= 1;
+    }
+
+    auto filter = (objc::selector_filter_t *)
+        calloc(sizeof(objc::selector_filter_t) + bits / 8, 1);
+    filter->mask = bits - 1;
+
+    for (Class c = cls; c; c = c->getSuperclass()) {
+        for (const auto& meth : c->data()->methods()) {
+            filter->add(meth.name());
+        }
+    }
+
+    if (PrintCaches) {
+        _objc_inform("CACHES: built negative lookup filter for class %s%s "
+                     "(%u selectors, %u bits)", cls->nameForLogging(),
+                     cls->isMetaClass() ? " (meta)" : "", count, bits);
+    }
+
+    return filter;
+}
+
+// Returns true if sel is definitely not implemented by cls or any superclass.
+static bool negativeLookupFilterExcludes_nolock(Class cls, SEL sel)
+{
+    runtimeLock.assertLocked();
+
+    if (!NegativeLookupFilter) return false;
+
+    auto *map = objc::negativeLookupFilters.get(false);
+    if (!map) return false;
+
+    auto it = map->find(cls);
+    if (it == map->end()  ||  !it->second.filter) return false;
+    return !it->second.filter->mayContain(sel);
+}
+
+// Records that a lookup of some selector in cls found nothing.
+static void negativeLookupFilterNoteMiss_nolock(Class cls)
+{
+    runtimeLock.assertLocked();
+
+    if (!NegativeLookupFilter) return;
+
+    auto& entry = (*objc::negativeLookupFilters.get(true))[cls];
+    if (!entry.filter  &&  ++entry.misses >= objc::negativeLookupBuildThreshold) {
+        entry.filter = buildSelectorFilter(cls);
+    }
+}
+
+static void negativeLookupFilterErase_nolock(Class cls)
+{
+    runtimeLock.assertLocked();
+
+    auto *map = objc::negativeLookupFilters.get(false);
+    if (!map) return;
+
+    auto it = map->find(cls);
+    if (it != map->end()) {
+        free(it->second.filter);
+        map->erase(it);
+    }
+}
+
+// Adds selectors that cls or a superclass may now implement.
+// Nil cls adds them to every filter.
+static void negativeLookupFilterAdd_nolock(Class cls, 
+                                           const SEL *sels, uint32_t selCount)
+{
+    runtimeLock.assertLocked();
+
+    auto *map = objc::negativeLookupFilters.get(false);
+    if (!map) return;
+
+    auto add = [&](objc::selector_filter_t *filter) {
+        if (!filter) return;
+        for (uint32_t i = 0; i < selCount; i++) {
+            filter->add(sels[i]);
+        }
+    };
+
+    if (cls) {
+        auto it = map->find(cls);
+        if (it != map->end()) add(it->second.filter);
+    } else {
+        for (auto& entry : *map) {
+            add(entry.second.filter);
+        }
+    }
+}
+
+static void negativeLookupFilterEraseAll_nolock()
+{
+    runtimeLock.assertLocked();
+
+    auto *map = objc::negativeLookupFilters.get(false);
+    if (!map) return;
+
+    for (auto& entry : *map) {
+        free(entry.second.filter);
+    }
+    map->clear();
+}
+
+
+void flush_selectors_t::add(const method_list_t *mlist)
+{
+    for (const auto& meth : *mlist) {
+        add(meth.name());
+    }
+}
+
+
+/***********************************************************************
+* flushCaches
+* Flushes the caches of cls and its subclasses for which predicate 
+* returns true. Nil flushes all classes.
+* If sels is given (sorted by address), only those selectors are removed
+* from each cache and the other entries stay warm. Otherwise each cache
+* is erased entirely.
+* Locking: runtimeLock must be held by the caller
 **********************************************************************/
-static void flushCaches(Class cls, const char *func, bool (^predicate)(Class))
+static void flushCaches(Class cls, const char *func, bool (^predicate)(Class),
+                        const SEL *sels, uint32_t selCount)
 {
     runtimeLock.assertLocked();
 #if CONFIG_USE_CACHE_LOCK
     mutex_locker_t lock(cacheUpdateLock);
 #endif
 
+    if (DisableScopedCacheFlush) sels = nil;
+
+    bool cxxChainsChanged = !sels;
+    for (uint32_t i = 0; i < selCount  &&  !cxxChainsChanged; i++) {
+        cxxChainsChanged = (sels[i] == SEL_cxx_construct  ||
+                            sels[i] == SEL_cxx_destruct);
+    }
+
     const auto handler = ^(Class c) {
         if (predicate(c)) {
-            c->cache.eraseNolock(func);
+            if (sels) {
+                c->cache.eraseSelectorsNolock(sels, selCount, func);
+            } else {
+                c->cache.eraseNolock(func);
+            }
+        }
+        if (cls  &&  sels) {
+            negativeLookupFilterAdd_nolock(c, sels, selCount);
+        } else if (cls) {
+            negativeLookupFilterErase_nolock(c);
+        }
+        if (cxxChainsChanged) {
+            cxxChainsErase_nolock(c);
         }
 
         return true;
@@ -3074,11 +3381,23 @@ static void flushCaches(Class cls, const char *func, bool (^predicate)(Class))
     if (cls) {
         foreach_realized_class_and_subclass(cls, handler);
     } else {
+        if (sels) {
+            negativeLookupFilterAdd_nolock(nil, sels, selCount);
+        } else {
+            negativeLookupFilterEraseAll_nolock();
+        }
         foreach_realized_class_and_metaclass(handler);
     }
 }
 
 
+/***********************************************************************
+* _objc_flush_caches
+* Flushes all caches.
+* (Historical behavior: flush caches for cls, its metaclass, 
+* and subclasses thereof. Nil flushes all classes.)
+* Locking: acquires runtimeLock
+**********************************************************************/
 void _objc_flush_caches(Class cls)
 {
     {
@@ -3124,9 +3443,31 @@ map_images(unsigned count, const char * const paths[],
 }
 
 
+/***********************************************************************
+* load_categories_nolock
+* Registers hi's categories with their target classes.
+* Categories on classes that are already realized are attached in a batch:
+* they are grouped by target class, all of their method lists are fixed up
+* under one acquisition of selLock, each class is rebuilt once no matter
+* how many of the image's categories it receives, and the method caches
+* are flushed once per attached class hierarchy instead of once per
+* category. Load order is preserved within each class.
+* Locking: runtimeLock must be held by the caller
+**********************************************************************/
 static void load_categories_nolock(header_info *hi) {
+    objc::TraceScope trace("category", [&]{ return hi->fname(); });
     bool hasClassProperties = hi->info()->hasCategoryClassProperties();
 
+    // Categories whose target class (or metaclass) is already realized,
+    // keyed by that class, oldest category first.
+    objc::DenseMap<Class, category_list> existing;
+    auto attachLater = [&](locstamped_category_t lc, Class cls) {
+        auto result = existing.try_emplace(cls, lc);
+        if (!result.second) {
+            result.first->second.append(lc);
+        }
+    };
+
     size_t count;
     auto processCatlist = [&](category_t * const *catlist) {
         for (unsigned i = 0; i < count; i++) {
@@ -3170,7 +3511,7 @@ static void load_categories_nolock(header_info *hi) {
                     ||  cat->instanceProperties)
                 {
                     if (cls->isRealized()) {
-                        attachCategories(cls, &lc, 1, ATTACH_EXISTING);
+                        attachLater(lc, cls);
                     } else {
                         objc::unattachedCategories.addForClass(lc, cls);
                     }
@@ -3180,7 +3521,7 @@ static void load_categories_nolock(header_info *hi) {
                     ||  (hasClassProperties && cat->_classProperties))
                 {
                     if (cls->ISA()->isRealized()) {
-                        attachCategories(cls->ISA(), &lc, 1, ATTACH_EXISTING | ATTACH_METACLASS);
+                        attachLater(lc, cls->ISA());
                     } else {
                         objc::unattachedCategories.addForClass(lc, cls->ISA());
                     }
@@ -3191,6 +3532,62 @@ static void load_categories_nolock(header_info *hi) {
 
     processCatlist(hi->catlist(&count));
     processCatlist(hi->catlist2(&count));
+
+    if (existing.empty()) return;
+
+    // Unique and sort every pending method list while taking selLock once.
+    // prepareMethodLists skips lists that are already fixed up.
+    {
+        bool isBundle = hi->isBundle();
+        mutex_locker_t lock(selLock);
+        for (auto &pair : existing) {
+            bool isMeta = pair.first->isMetaClass();
+            auto &list = pair.second;
+            for (uint32_t i = 0; i < list.count(); i++) {
+                method_list_t *mlist = list.array()[i].cat->methodsForMeta(isMeta);
+                if (mlist && !mlist->isFixedUp()) {
+                    fixupMethodList(mlist, isBundle, true, true /*selLockHeld*/);
+                }
+            }
+        }
+    }
+
+    // Attach each class's categories in one pass, then flush.
+    objc::DenseSet<Class> attached;
+    flush_selectors_t sels;
+    for (auto &pair : existing) {
+        Class cls = pair.first;
+        bool isMeta = cls->isMetaClass();
+        auto &list = pair.second;
+        attachCategories(cls, list.array(), list.count(),
+                         ATTACH_EXISTING | ATTACH_DEFER_FLUSH |
+                         (isMeta ? ATTACH_METACLASS : ATTACH_CLASS));
+        for (uint32_t i = 0; i < list.count(); i++) {
+            if (method_list_t *mlist = list.array()[i].cat->methodsForMeta(isMeta)) {
+                attached.insert(cls);
+                sels.add(mlist);
+            }
+        }
+    }
+
+    // flushCaches() covers subclasses, so a class whose superclass chain
+    // contains another attached class is flushed along with it.
+    for (Class cls : attached) {
+        bool coveredBySuper = false;
+        for (Class c = cls->getSuperclass(); c; c = c->getSuperclass()) {
+            if (attached.count(c)) {
+                coveredBySuper = true;
+                break;
+            }
+        }
+        if (coveredBySuper) continue;
+
+        flushCaches(cls, __func__, [](Class c){
+            // constant caches have been dealt with in prepareMethodLists
+            // if the class still is constant here, it's fine to keep
+            return !c->cache.isConstantOptimizedCache();
+        }, sels.sels(), sels.count());
+    }
 }
 
 static void loadAllCategories() {
@@ -3489,6 +3886,78 @@ readProtocol(protocol_t *newproto, Class protocol_class,
     }
 }
 
+/***********************************************************************
+* fixupSelectorRefsInParallel
+* Fixes up the @selector references of hList's images on worker threads.
+* Returns the number of selector references visited.
+*
+* Workers only look selectors up and never register one. The calling 
+* thread holds selLock throughout, so the selector table is read-only 
+* while they run. References to selectors that are not registered yet
+* are remembered per image and registered afterwards on this thread in
+* image order, which leaves the selector table exactly as the serial
+* loop in _read_images would.
+*
+* Locking: runtimeLock and selLock must be held by the caller.
+**********************************************************************/
+static size_t
+fixupSelectorRefsInParallel(header_info **hList, uint32_t hCount)
+{
+    runtimeLock.assertLocked();
+    selLock.assertLocked();
+
+    size_t *refCounts = (size_t *)calloc(hCount, sizeof(size_t));
+    size_t *pendingCounts = (size_t *)calloc(hCount, sizeof(size_t));
+    uint32_t **pending = (uint32_t **)calloc(hCount, sizeof(uint32_t *));
+
+    dispatch_apply(hCount, DISPATCH_APPLY_AUTO, ^(size_t hIndex) {
+        header_info *hi = hList[hIndex];
+        if (hi->hasPreoptimizedSelectors()) return;
+
+        size_t count;
+        SEL *sels = _getObjc2SelectorRefs(hi, &count);
+        refCounts[hIndex] = count;
+        for (size_t i = 0; i < count; i++) {
+            SEL sel = sel_lookUpNameNoLock(sel_cname(sels[i]));
+            if (sel) {
+                if (sels[i] != sel) {
+                    sels[i] = sel;
+                }
+            } else {
+                if (!pending[hIndex]) {
+                    pending[hIndex] = (uint32_t *)malloc(count * sizeof(uint32_t));
+                }
+                pending[hIndex][pendingCounts[hIndex]++] = (uint32_t)i;
+            }
+        }
+    });
+
+    size_t total = 0;
+    for (uint32_t hIndex = 0; hIndex < hCount; hIndex++) {
+        total += refCounts[hIndex];
+        if (!pending[hIndex]) continue;
+
+        header_info *hi = hList[hIndex];
+        bool isBundle = hi->isBundle();
+        size_t count;
+        SEL *sels = _getObjc2SelectorRefs(hi, &count);
+        for (size_t i = 0; i < pendingCounts[hIndex]; i++) {
+            SEL *ref = &sels[pending[hIndex][i]];
+            SEL sel = sel_registerNameNoLock(sel_cname(*ref), isBundle);
+            if (*ref != sel) {
+                *ref = sel;
+            }
+        }
+        free(pending[hIndex]);
+    }
+
+    free(pending);
+    free(pendingCounts);
+    free(refCounts);
+
+    return total;
+}
+
 /***********************************************************************
 * _read_images
 * Perform initial processing of the headers in the linked 
@@ -3592,26 +4061,36 @@ void _read_images(header_info **hList, uint32_t hCount, int totalClasses, int un
     }
 
     // Fix up @selector references
+    // Not while _objc_init registers with dyld. That can happen during 
+    // libdispatch's own initialization, before dispatch_apply can run.
     static size_t UnfixedSelectors;
+    bool parallelSelectorFixup = 
+        ParallelImageFixups  &&  didCallDyldNotifyRegister  &&  hCount > 1;
     {
         mutex_locker_t lock(selLock);
-        for (EACH_HEADER) {
-            if (hi->hasPreoptimizedSelectors()) continue;
-
-            bool isBundle = hi->isBundle();
-            SEL *sels = _getObjc2SelectorRefs(hi, &count);
-            UnfixedSelectors += count;
-            for (i = 0; i < count; i++) {
-                const char *name = sel_cname(sels[i]);
-                SEL sel = sel_registerNameNoLock(name, isBundle);
-                if (sels[i] != sel) {
-                    sels[i] = sel;
+        if (parallelSelectorFixup) {
+            UnfixedSelectors += fixupSelectorRefsInParallel(hList, hCount);
+        } else {
+            for (EACH_HEADER) {
+                if (hi->hasPreoptimizedSelectors()) continue;
+
+                bool isBundle = hi->isBundle();
+                SEL *sels = _getObjc2SelectorRefs(hi, &count);
+                UnfixedSelectors += count;
+                for (i = 0; i < count; i++) {
+                    const char *name = sel_cname(sels[i]);
+                    SEL sel = sel_registerNameNoLock(name, isBundle);
+                    if (sels[i] != sel) {
+                        sels[i] = sel;
+                    }
                 }
             }
         }
     }
 
-    ts.log("IMAGE TIMES: fix up selector references");
+    ts.log(parallelSelectorFixup
+           ? "IMAGE TIMES: fix up selector references (parallel)"
+           : "IMAGE TIMES: fix up selector references");
 
     // Discover classes. Fix up unresolved future classes. Mark bundle classes.
     bool hasDyldRoots = dyld_shared_cache_some_image_overridden();
@@ -4071,7 +4550,7 @@ _method_setImplementation(Class cls, method_t *m, IMP imp)
 
     flushCaches(cls, __func__, [sel, old](Class c){
         return c->cache.shouldFlush(sel, old);
-    });
+    }, &sel, 1);
 
     adjustCustomFlagsForMethodChange(cls, m);
 
@@ -4113,9 +4592,12 @@ void method_exchangeImplementations(Method m1, Method m2)
     // Cache updates are slow because class is unknown
     // fixme build list of classes whose Methods are known externally?
 
+    flush_selectors_t sels;
+    sels.add(sel1);
+    sels.add(sel2);
     flushCaches(nil, __func__, [sel1, sel2, imp1, imp2](Class c){
         return c->cache.shouldFlush(sel1, imp1) || c->cache.shouldFlush(sel2, imp2);
-    });
+    }, sels.sels(), sels.count());
 
     adjustCustomFlagsForMethodChange(nil, m1);
     adjustCustomFlagsForMethodChange(nil, m2);
@@ -5511,35 +5993,359 @@ class_copyProtocolList(Class cls, unsigned int *outCount)
 
 
 /***********************************************************************
-* objc_copyImageNames
-* Copies names of loaded images with ObjC contents.
-*
-* Locking: acquires runtimeLock
+* Metadata enumerators
+* Visit the same entries as the copy*List functions without allocating.
+* Entries are gathered into an on-stack batch under runtimeLock, and 
+* fn is called for the batch after unlocking so it may call back into 
+* the runtime. Method, property and protocol lists are never freed 
+* while their class exists, so each batch resumes in the list where 
+* the last one stopped even if categories attached lists meanwhile. 
+* Entries added during enumeration may or may not be visited.
+* Locking: acquires runtimeLock once per batch
 **********************************************************************/
-const char **objc_copyImageNames(unsigned int *outCount)
+static constexpr unsigned EnumerationBatchSize = 64;
+
+static Method 
+enumerationElement(method_list_t *list, uint32_t i)
 {
-    mutex_locker_t lock(runtimeLock);
+    return &list->get(i);
+}
 
-    int HeaderCount = 0;
-    for (header_info *hi = FirstHeader; hi != nil; hi = hi->getNext()) {
-        HeaderCount++;
-    }
+static objc_property_t 
+enumerationElement(property_list_t *list, uint32_t i)
+{
+    return (objc_property_t)&list->get(i);
+}
 
-#if TARGET_OS_WIN32
-    const TCHAR **names = (const TCHAR **)
-        malloc((HeaderCount+1) * sizeof(TCHAR *));
-#else
-    const char **names = (const char **)
-        malloc((HeaderCount+1) * sizeof(char *));
-#endif
+static Protocol * 
+enumerationElement(protocol_list_t *list, uint32_t i)
+{
+    return (Protocol *)remapProtocol(list->list[i]);
+}
 
-    unsigned int count = 0;
-    for (header_info *hi = FirstHeader; hi != nil; hi = hi->getNext()) {
-#if TARGET_OS_WIN32
-        if (hi->moduleName) {
-            names[count++] = hi->moduleName;
+template <typename T, typename GetLists>
+static unsigned int
+enumerateListArray(Class cls, GetLists getLists, 
+                   bool (*fn)(T, void *), void *context)
+{
+    if (!cls  ||  !fn) return 0;
+
+    T batch[EnumerationBatchSize];
+    const void *resumeList = nil;
+    uint32_t resumeIndex = 0;
+    unsigned int visited = 0;
+
+    while (true) {
+        unsigned int count = 0;
+        bool more = false;
+        {
+            mutex_locker_t lock(runtimeLock);
+            checkIsKnownClass(cls);
+            ASSERT(cls->isRealized());
+
+            const auto lists = getLists(cls->data());
+            auto cursor = lists.beginLists();
+            auto end = lists.endLists();
+            // Lists attached since the last batch come first.
+            if (resumeList) {
+                while (cursor != end  &&  cursor->get() != resumeList) cursor++;
+            }
+
+            for ( ; cursor != end  &&  !more; cursor++) {
+                auto *list = cursor->get();
+                uint32_t i = resumeList == list ? resumeIndex : 0;
+                for ( ; i < list->count; i++) {
+                    if (count == EnumerationBatchSize) {
+                        resumeList = list;
+                        resumeIndex = i;
+                        more = true;
+                        break;
+                    }
+                    batch[count++] = enumerationElement(list, i);
+                }
+            }
         }
-#else
+
+        for (unsigned int i = 0; i < count; i++) {
+            visited++;
+            if (!fn(batch[i], context)) return visited;
+        }
+        if (!more) return visited;
+    }
+}
+
+unsigned int
+_class_enumerateMethods(Class cls, bool (*fn)(Method, void *), void *context)
+{
+    return enumerateListArray(cls, [](class_rw_t *rw) {
+        return rw->methods();
+    }, fn, context);
+}
+
+unsigned int
+_class_enumerateProperties(Class cls, bool (*fn)(objc_property_t, void *), 
+                           void *context)
+{
+    return enumerateListArray(cls, [](class_rw_t *rw) {
+        return rw->properties();
+    }, fn, context);
+}
+
+unsigned int
+_class_enumerateProtocols(Class cls, bool (*fn)(Protocol *, void *), 
+                          void *context)
+{
+    return enumerateListArray(cls, [](class_rw_t *rw) {
+        return rw->protocols();
+    }, fn, context);
+}
+
+unsigned int
+_class_enumerateIvars(Class cls, bool (*fn)(Ivar, void *), void *context)
+{
+    if (!cls  ||  !fn) return 0;
+
+    Ivar batch[EnumerationBatchSize];
+    uint32_t resumeIndex = 0;
+    unsigned int visited = 0;
+
+    while (true) {
+        unsigned int count = 0;
+        bool more = false;
+        {
+            mutex_locker_t lock(runtimeLock);
+            ASSERT(cls->isRealized());
+
+            // class_addIvar() may reallocate the list, so resume by index.
+            const ivar_list_t *ivars = cls->data()->ro()->ivars;
+            for (uint32_t i = resumeIndex; ivars  &&  i < ivars->count; i++) {
+                if (count == EnumerationBatchSize) {
+                    resumeIndex = i;
+                    more = true;
+                    break;
+                }
+                auto& ivar = ivars->get(i);
+                if (!ivar.offset) continue;  // anonymous bitfield
+                batch[count++] = &ivar;
+            }
+        }
+
+        for (unsigned int i = 0; i < count; i++) {
+            visited++;
+            if (!fn(batch[i], context)) return visited;
+        }
+        if (!more) return visited;
+    }
+}
+
+// The realized class after cls in depth-first order, not descending 
+// into metaclasses. Roots are siblings of each other.
+// Locking: runtimeLock must be held by the caller.
+static Class
+nextRealizedClass(Class cls)
+{
+    runtimeLock.assertLocked();
+
+    if (!cls->isMetaClass()  &&  cls->data()->firstSubclass) {
+        return cls->data()->firstSubclass;
+    }
+    while (!cls->data()->nextSiblingClass) {
+        cls = cls->getSuperclass();
+        if (!cls) return nil;
+    }
+    return cls->data()->nextSiblingClass;
+}
+
+// True if cls is still a realized class. Unlike isKnownClass(), 
+// this does not read cls, which may have been freed or unmapped.
+// Locking: runtimeLock must be held by the caller.
+static bool
+isLiveRealizedClass(Class cls)
+{
+    runtimeLock.assertLocked();
+
+    uint32_t index;
+    auto &set = objc::allocatedClasses.get();
+    if (set.find(cls) == set.end()  &&
+        !objc::dataSegmentsRanges.find((uintptr_t)cls, index))
+    {
+        return false;
+    }
+    return cls->isRealized();
+}
+
+// The class tree may change while runtimeLock is dropped between 
+// batches. If it did, the walk resumes only if the last class visited 
+// still exists, and otherwise starts over.
+unsigned int
+_objc_enumerateClasses(bool (*fn)(Class, void *), void *context)
+{
+    if (!fn) return 0;
+
+    Class batch[EnumerationBatchSize];
+    Class resumeClass = nil;
+    uintptr_t generation = 0;
+    unsigned int visited = 0;
+
+    while (true) {
+        unsigned int count = 0;
+        bool more;
+        {
+            mutex_locker_t lock(runtimeLock);
+            if (resumeClass  &&  
+                generation != objc_debug_realized_class_generation_count  &&
+                !isLiveRealizedClass(resumeClass))
+            {
+                resumeClass = nil;
+            }
+
+            Class cls;
+            if (!resumeClass) {
+                realizeAllClasses();
+                cls = _firstRealizedClass;
+            } else {
+                cls = nextRealizedClass(resumeClass);
+            }
+
+            while (cls  &&  count < EnumerationBatchSize) {
+                if (!cls->isMetaClass()) batch[count++] = cls;
+                resumeClass = cls;
+                cls = nextRealizedClass(cls);
+            }
+            more = (cls != nil);
+            generation = objc_debug_realized_class_generation_count;
+        }
+
+        for (unsigned int i = 0; i < count; i++) {
+            visited++;
+            if (!fn(batch[i], context)) return visited;
+        }
+        if (!more) return visited;
+    }
+}
+
+
+/***********************************************************************
+* _objc_copyClassSnapshot
+* Describes every realized class in a single allocation with no 
+* internal pointers. Both passes over the class tree happen under one 
+* hold of runtimeLock, so superclass indexes and counts agree.
+* Locking: acquires runtimeLock
+**********************************************************************/
+objc_class_snapshot *
+_objc_copyClassSnapshot(void)
+{
+    mutex_locker_t lock(runtimeLock);
+#if CONFIG_USE_CACHE_LOCK
+    mutex_locker_t cacheLock(cacheUpdateLock);
+#endif
+
+    // Number the classes and size the string table.
+    objc::DenseMap<Class, uint32_t> indexes;
+    size_t stringsSize = 0;
+    foreach_realized_class([&](Class cls) {
+        uint32_t index = (uint32_t)indexes.size();
+        indexes[cls] = index;
+        stringsSize += strlen(cls->demangledName(false)) + 1;
+        return true;
+    });
+
+    uint32_t count = (uint32_t)indexes.size();
+    size_t stringsOffset = sizeof(objc_class_snapshot) + 
+        count * sizeof(objc_class_snapshot_entry);
+    size_t size = stringsOffset + stringsSize;
+
+    auto snapshot = (objc_class_snapshot *)calloc(size, 1);
+    snapshot->magic = OBJC_CLASS_SNAPSHOT_MAGIC;
+    snapshot->version = OBJC_CLASS_SNAPSHOT_VERSION;
+    snapshot->classCount = count;
+    snapshot->entrySize = sizeof(objc_class_snapshot_entry);
+    snapshot->stringsOffset = stringsOffset;
+    snapshot->size = size;
+
+    char *strings = (char *)snapshot + stringsOffset;
+    uint32_t nameOffset = 0;
+    uint32_t i = 0;
+    foreach_realized_class([&](Class cls) {
+        objc_class_snapshot_entry& entry = snapshot->classes[i++];
+        auto rw = cls->data();
+        auto ro = rw->ro();
+
+        entry.address = (uint64_t)(uintptr_t)cls;
+
+        const char *name = cls->demangledName(false);
+        size_t len = strlen(name) + 1;
+        memcpy(strings + nameOffset, name, len);
+        entry.nameOffset = nameOffset;
+        nameOffset += (uint32_t)len;
+
+        Class supercls = cls->getSuperclass();
+        entry.superclassIndex = supercls 
+            ? indexes[supercls] : OBJC_CLASS_SNAPSHOT_NO_SUPERCLASS;
+        entry.instanceSize = cls->unalignedInstanceSize();
+
+        uint32_t flags = 0;
+        if (cls->isInitialized()) flags |= OBJC_CLASS_SNAPSHOT_INITIALIZED;
+        if (cls->isAnySwift()) flags |= OBJC_CLASS_SNAPSHOT_SWIFT;
+        if (cls->hasCxxCtor()) flags |= OBJC_CLASS_SNAPSHOT_CXX_CTOR;
+        if (cls->hasCxxDtor()) flags |= OBJC_CLASS_SNAPSHOT_CXX_DTOR;
+        if (cls->hasCustomRR()) flags |= OBJC_CLASS_SNAPSHOT_CUSTOM_RR;
+        if (cls->ISA()->hasCustomAWZ()) flags |= OBJC_CLASS_SNAPSHOT_CUSTOM_AWZ;
+        if (cls->instancesRequireRawIsa()) flags |= OBJC_CLASS_SNAPSHOT_RAW_ISA;
+        entry.flags = flags;
+
+        entry.methodCount = rw->methods().count();
+        entry.classMethodCount = cls->ISA()->data()->methods().count();
+        if (ro->ivars) {
+            for (auto& ivar : *ro->ivars) {
+                if (ivar.offset) entry.ivarCount++;  // not anonymous bitfields
+            }
+        }
+        entry.propertyCount = rw->properties().count();
+        entry.protocolCount = rw->protocols().count();
+
+        entry.cacheOccupied = cls->cache.occupied();
+        entry.cacheCapacity = cls->cache.capacity();
+        return true;
+    });
+
+    ASSERT(i == count);
+    ASSERT(nameOffset == stringsSize);
+
+    return snapshot;
+}
+
+
+/***********************************************************************
+* objc_copyImageNames
+* Copies names of loaded images with ObjC contents.
+*
+* Locking: acquires runtimeLock
+**********************************************************************/
+const char **objc_copyImageNames(unsigned int *outCount)
+{
+    mutex_locker_t lock(runtimeLock);
+
+    int HeaderCount = 0;
+    for (header_info *hi = FirstHeader; hi != nil; hi = hi->getNext()) {
+        HeaderCount++;
+    }
+
+#if TARGET_OS_WIN32
+    const TCHAR **names = (const TCHAR **)
+        malloc((HeaderCount+1) * sizeof(TCHAR *));
+#else
+    const char **names = (const char **)
+        malloc((HeaderCount+1) * sizeof(char *));
+#endif
+
+    unsigned int count = 0;
+    for (header_info *hi = FirstHeader; hi != nil; hi = hi->getNext()) {
+#if TARGET_OS_WIN32
+        if (hi->moduleName) {
+            names[count++] = hi->moduleName;
+        }
+#else
         const char *fname = hi->fname();
         if (fname) {
             names[count++] = fname;
@@ -5683,6 +6489,97 @@ objc_copyClassesForImage(const char *image, unsigned int *outCount)
     return copyClassesForImage_nolock(hi, outCount);
 }
 
+
+/***********************************************************************
+* objc_initializeClasses
+* Sends +initialize to classes and their superclasses ahead of time.
+* Classes are grouped by their topmost superclass that is not yet
+* initialized. Groups share no uninitialized classes, so they are
+* initialized in parallel, and each group is initialized serially from
+* its shallowest class down. initializeNonMetaClass() still initializes
+* superclasses first and defers a subclass that finishes early through
+* _finishInitializingAfter(), as for any other +initialize.
+* Locking: acquires runtimeLock; +initialize runs without it
+**********************************************************************/
+struct initialize_work_t {
+    Class cls;
+    Class root;         // topmost uninitialized class at or above cls
+    uint32_t depth;     // superclasses between root and cls
+};
+
+void
+objc_initializeClasses(Class _Nullable const * _Nullable classes, 
+                       unsigned int count)
+{
+    if (!classes  ||  count == 0) return;
+
+    auto work = (initialize_work_t *)calloc(count, sizeof(initialize_work_t));
+    unsigned workCount = 0;
+    {
+        mutex_locker_t lock(runtimeLock);
+        for (unsigned i = 0; i < count; i++) {
+            Class cls = classes[i];
+            if (!cls) continue;
+            checkIsKnownClass(cls);
+            cls = realizeClassMaybeSwiftAndLeaveLocked(cls, runtimeLock);
+            if (cls->isMetaClass()  ||  cls->isInitialized()) continue;
+
+            initialize_work_t& w = work[workCount++];
+            w.cls = cls;
+            for (Class c = cls; c  &&  !c->isInitialized(); c = c->getSuperclass()) {
+                if (w.root) w.depth++;
+                w.root = c;
+            }
+        }
+    }
+
+    // Group by root, shallowest classes first within each group.
+    qsort(work, workCount, sizeof(work[0]), [](const void *a, const void *b) {
+        auto *wa = (const initialize_work_t *)a;
+        auto *wb = (const initialize_work_t *)b;
+        if (wa->root != wb->root) return wa->root < wb->root ? -1 : 1;
+        if (wa->depth != wb->depth) return wa->depth < wb->depth ? -1 : 1;
+        return 0;
+    });
+
+    auto groups = (unsigned *)malloc((workCount + 1) * sizeof(unsigned));
+    unsigned groupCount = 0;
+    for (unsigned i = 0; i < workCount; i++) {
+        if (i == 0  ||  work[i].root != work[i-1].root) groups[groupCount++] = i;
+    }
+    groups[groupCount] = workCount;
+
+    if (PrintInitializing) {
+        _objc_inform("INITIALIZE: thread %p: initializing %u classes "
+                     "in %u independent hierarchies", objc_thread_self(), 
+                     workCount, groupCount);
+    }
+
+    auto initializeGroup = ^(size_t g) {
+        for (unsigned i = groups[g]; i < groups[g+1]; i++) {
+            class_initialize(work[i].cls, nil);
+        }
+    };
+    if (groupCount > 1  &&  !MultithreadedForkChild) {
+        dispatch_apply(groupCount, DISPATCH_APPLY_AUTO, initializeGroup);
+    } else {
+        for (unsigned g = 0; g < groupCount; g++) initializeGroup(g);
+    }
+
+    free(groups);
+    free(work);
+}
+
+
+void
+objc_initializeClassesForImage(const char * _Nonnull image)
+{
+    unsigned int count;
+    Class *classes = objc_copyClassesForImage(image, &count);
+    objc_initializeClasses(classes, count);
+    free(classes);
+}
+
 /***********************************************************************
 * objc_copyClassNamesForImageHeader
 * Copies class names from the given image.
@@ -5921,6 +6818,13 @@ class_setVersion(Class cls, int version)
 /***********************************************************************
  * search_method_list_inline
  **********************************************************************/
+
+// Sorted method lists with at most this many entries are scanned
+// linearly. Most method lists are this short, and for them a forward
+// scan with an early exit is cheaper than the mispredicted branches
+// of a binary search.
+static constexpr uint32_t methodListLinearSearchCount = 16;
+
 template<class getNameFunc>
 ALWAYS_INLINE static method_t *
 findMethodInSortedMethodList(SEL key, const method_list_t *list, const getNameFunc &getName)
@@ -5928,33 +6832,44 @@ findMethodInSortedMethodList(SEL key, const method_list_t *list, const getNameFu
     ASSERT(list);
 
     auto first = list->begin();
-    auto base = first;
-    decltype(first) probe;
-
     uintptr_t keyValue = (uintptr_t)key;
-    uint32_t count;
-    
-    for (count = list->count; count != 0; count >>= 1) {
-        probe = base + (count >> 1);
-        
-        uintptr_t probeValue = (uintptr_t)getName(probe);
-        
-        if (keyValue == probeValue) {
-            // `probe` is a match.
-            // Rewind looking for the *first* occurrence of this value.
-            // This is required for correct category overrides.
-            while (probe > first && keyValue == (uintptr_t)getName((probe - 1))) {
-                probe--;
+    uint32_t count = list->count;
+
+    if (count <= methodListLinearSearchCount) {
+        // The list is sorted, so the first entry that is not below
+        // the key is the *first* occurrence of it, if present.
+        // This is required for correct category overrides.
+        for (uint32_t i = 0; i < count; i++) {
+            uintptr_t probeValue = (uintptr_t)getName(first + i);
+            if (probeValue >= keyValue) {
+                return probeValue == keyValue ? &*(first + i) : nil;
             }
-            return &*probe;
-        }
-        
-        if (keyValue > probeValue) {
-            base = probe + 1;
-            count--;
         }
+        return nil;
+    }
+
+    // Branchless lower bound. Each step only picks which half to keep,
+    // which compiles to a conditional move rather than a branch, and
+    // lands on the *first* occurrence of the key without rewinding.
+    // The next step probes base' + next - 1, where base' is base or 
+    // base + half, or reads base' itself once no step is left. Both 
+    // candidates are prefetched while the current probe is compared.
+    uint32_t base = 0;
+    while (count > 1) {
+        uint32_t half = count >> 1;
+        uint32_t next = (count - half) >> 1;
+        uint32_t nextProbe = next ? next - 1 : 0;
+        __builtin_prefetch(&*(first + (base + nextProbe)));
+        __builtin_prefetch(&*(first + (base + half + nextProbe)));
+        uintptr_t probeValue = (uintptr_t)getName(first + (base + half - 1));
+        base = (probeValue < keyValue) ? base + half : base;
+        count -= half;
+    }
+
+    auto probe = first + base;
+    if ((uintptr_t)getName(probe) == keyValue) {
+        return &*probe;
     }
-    
     return nil;
 }
 
@@ -6061,6 +6976,62 @@ method_lists_contains_any(T *mlists, T *end,
 }
 
 
+/***********************************************************************
+ * getMethodFromIndex_nolock
+ * Searches cls's merged method index, building it first if needed.
+ * Only used for classes with at least method_index_t::minLists lists.
+ * Locking: runtimeLock must be held by the caller
+ **********************************************************************/
+static NEVER_INLINE method_t *
+getMethodFromIndex_nolock(Class cls, SEL sel)
+{
+    runtimeLock.assertLocked();
+
+    // A class with more than one method list always has a class_rw_ext_t.
+    auto rwe = cls->data()->ext();
+    ASSERT(rwe);
+
+    method_index_t *index = rwe->methodIndex;
+    if (!index) {
+        uint32_t total = rwe->methods.count();
+        index = (method_index_t *)malloc(method_index_t::byteSize(total));
+
+        // Method lists are visited in search order, so after a stable sort
+        // the first entry for each selector is the one that wins.
+        uint32_t i = 0;
+        for (const auto& meth : rwe->methods) {
+            index->entries[i].name = meth.name();
+            index->entries[i].meth = (method_t *)&meth;
+            i++;
+        }
+        ASSERT(i == total);
+
+        auto first = index->entries, last = index->entries + total;
+        std::stable_sort(first, last, [](const method_index_t::entry_t& lhs,
+                                         const method_index_t::entry_t& rhs) {
+            return (uintptr_t)lhs.name < (uintptr_t)rhs.name;
+        });
+        index->count = (uint32_t)(std::unique(first, last,
+                                  [](const method_index_t::entry_t& lhs,
+                                     const method_index_t::entry_t& rhs) {
+            return lhs.name == rhs.name;
+        }) - first);
+
+        if (PrintConnecting) {
+            _objc_inform("CLASS: built method index for class '%s'%s "
+                         "(%u methods in %u lists)", cls->nameForLogging(),
+                         cls->isMetaClass() ? " (meta)" : "", index->count,
+                         (uint32_t)(rwe->methods.endLists() -
+                                    rwe->methods.beginLists()));
+        }
+
+        rwe->methodIndex = index;
+    }
+
+    return index->find(sel);
+}
+
+
 /***********************************************************************
  * getMethodNoSuper_nolock
  * fixme
@@ -6076,10 +7047,17 @@ getMethodNoSuper_nolock(Class cls, SEL sel)
     // fixme nil sel?
 
     auto const methods = cls->data()->methods();
-    for (auto mlists = methods.beginLists(),
-              end = methods.endLists();
-         mlists != end;
-         ++mlists)
+    auto mlists = methods.beginLists(), end = methods.endLists();
+
+    // Classes with many categories search one merged index instead
+    // of binary-searching every method list.
+    if (slowpath(end - mlists >= method_index_t::minLists  &&
+                 !DisableMethodIndex))
+    {
+        return getMethodFromIndex_nolock(cls, sel);
+    }
+
+    for (; mlists != end; ++mlists)
     {
         // <rdar://problem/46904873> getMethodNoSuper_nolock is the hottest
         // caller of search_method_list, inlining it turns
@@ -6446,6 +7424,12 @@ IMP lookUpImpOrForward(id inst, SEL sel, Class cls, int behavior)
     // The only codepath calling into this without having performed some
     // kind of cache lookup is class_getInstanceMethod().
 
+    if (slowpath(negativeLookupFilterExcludes_nolock(cls, sel))) {
+        // Nothing in the hierarchy implements sel. Skip the walk.
+        imp = forward_imp;
+        goto resolve;
+    }
+
     for (unsigned attempts = unreasonableClassCount();;) {
         if (curClass->cache.isConstantOptimizedCache(/* strict */true)) {
 #if CONFIG_USE_PREOPT_CACHES
@@ -6488,6 +7472,9 @@ IMP lookUpImpOrForward(id inst, SEL sel, Class cls, int behavior)
         }
     }
 
+    negativeLookupFilterNoteMiss_nolock(cls);
+
+ resolve:
     // No implementation found. Try method resolver once.
 
     if (slowpath(behavior & LOOKUP_RESOLVER)) {
@@ -6564,6 +7551,219 @@ IMP lookupMethodInClassAndLoadCache(Class cls, SEL sel)
 }
 
 
+/***********************************************************************
+* cxxChains
+* Per-class flat arrays of the .cxx_construct and .cxx_destruct IMPs 
+* that object_cxxConstructFromClass() and object_cxxDestruct() call.
+*
+* Chains are built when a class is initialized, or at its first C++
+* construction or destruction if that comes first. Allocation and 
+* deallocation read the table without locks. Chains are built and 
+* erased with runtimeLock held, so a chain can never be built from 
+* method lists that are being changed. A chain erased because methods
+* changed is leaked because a concurrent allocation or deallocation 
+* may still be running it. A class's slot and chains are freed when 
+* the class is disposed or unloaded, so that a new class at the same 
+* address does not run them. Classes that find no free slot walk 
+* their superclasses every time.
+**********************************************************************/
+namespace objc {
+
+struct cxx_chain_slot_t {
+    std::atomic<Class> cls;
+    std::atomic<cxx_chain_t *> ctors;
+    std::atomic<cxx_chain_t *> dtors;
+};
+
+// Must be a power of two.
+static constexpr uint32_t cxxChainSlotCount = 1024;
+static constexpr uint32_t cxxChainProbes = 16;
+
+static std::atomic<cxx_chain_slot_t *> cxxChainSlots;
+
+// The class of a slot whose class was freed. Lookups probe past it, 
+// and a new class may take it.
+#define CXX_CHAIN_SLOT_FREED ((Class)1)
+
+// A class that finds all of its probes taken by other live classes 
+// does not get a slot. outFull is set if no slot could be taken.
+static cxx_chain_slot_t *
+cxxChainSlot(cxx_chain_slot_t *slots, Class cls, bool create, 
+             bool *outFull = nil)
+{
+    uintptr_t hash = (uintptr_t)cls >> 3;
+    cxx_chain_slot_t *freeSlot = nil;
+    for (uint32_t i = 0; i < cxxChainProbes; i++) {
+        cxx_chain_slot_t *slot = &slots[(hash + i) & (cxxChainSlotCount - 1)];
+        Class slotCls = slot->cls.load(std::memory_order_acquire);
+        if (slotCls == cls) return slot;
+        if (slotCls == CXX_CHAIN_SLOT_FREED) {
+            if (!freeSlot) freeSlot = slot;
+        } else if (!slotCls) {
+            if (!freeSlot) freeSlot = slot;
+            break;
+        }
+    }
+    if (!freeSlot) {
+        if (outFull) *outFull = true;
+        return nil;
+    }
+    if (!create) return nil;
+
+    runtimeLock.assertLocked();
+    freeSlot->cls.store(cls, std::memory_order_release);
+    return freeSlot;
+}
+
+// Constructors are listed base class first, destructors most-derived 
+// class first, which is the order they are called in.
+static cxx_chain_t *
+buildCxxChain_nolock(Class cls, bool ctors)
+{
+    runtimeLock.assertLocked();
+
+    SEL sel = ctors ? SEL_cxx_construct : SEL_cxx_destruct;
+    auto has = [ctors](Class c) {
+        return ctors ? c->hasCxxCtor() : c->hasCxxDtor();
+    };
+
+    uint32_t count = 0;
+    for (Class c = cls; c  &&  has(c); c = c->getSuperclass()) {
+        count++;
+    }
+
+    auto chain = (cxx_chain_t *)
+        calloc(sizeof(cxx_chain_t) + count * sizeof(chain->entries[0]), 1);
+    for (Class c = cls; c  &&  has(c); c = c->getSuperclass()) {
+        if (auto meth = getMethodNoSuper_nolock(c, sel)) {
+            chain->entries[chain->count].cls = c;
+            chain->entries[chain->count].imp = meth->imp(false);
+            chain->count++;
+        }
+    }
+
+    if (ctors) {
+        for (uint32_t i = 0; i < chain->count / 2; i++) {
+            std::swap(chain->entries[i], chain->entries[chain->count - 1 - i]);
+        }
+    }
+    return chain;
+}
+
+static cxx_chain_t *
+cxxChainIfNeeded_nolock(cxx_chain_slot_t *slot, Class cls, bool ctors)
+{
+    runtimeLock.assertLocked();
+
+    auto& field = ctors ? slot->ctors : slot->dtors;
+    auto *chain = field.load(std::memory_order_relaxed);
+    if (!chain) {
+        chain = buildCxxChain_nolock(cls, ctors);
+        field.store(chain, std::memory_order_release);
+    }
+    return chain;
+}
+
+static cxx_chain_slot_t *
+cxxChainSlotIfNeeded_nolock(Class cls)
+{
+    runtimeLock.assertLocked();
+
+    auto *slots = cxxChainSlots.load(std::memory_order_relaxed);
+    if (!slots) {
+        slots = (cxx_chain_slot_t *)
+            calloc(cxxChainSlotCount, sizeof(cxx_chain_slot_t));
+        cxxChainSlots.store(slots, std::memory_order_release);
+    }
+    return cxxChainSlot(slots, cls, true);
+}
+
+static const cxx_chain_t *
+cxxChain(Class cls, bool ctors)
+{
+    cxx_chain_slot_t *slots = cxxChainSlots.load(std::memory_order_acquire);
+    if (fastpath(slots)) {
+        bool full = false;
+        cxx_chain_slot_t *slot = cxxChainSlot(slots, cls, false, &full);
+        if (fastpath(slot)) {
+            auto& field = ctors ? slot->ctors : slot->dtors;
+            auto *chain = field.load(std::memory_order_acquire);
+            if (fastpath(chain)) return chain;
+        }
+        if (full) return nil;
+    }
+
+    mutex_locker_t lock(runtimeLock);
+    cxx_chain_slot_t *slot = cxxChainSlotIfNeeded_nolock(cls);
+    if (!slot) return nil;
+    return cxxChainIfNeeded_nolock(slot, cls, ctors);
+}
+
+// Return cls's constructor or destructor chain, building it if necessary.
+// Return nil if cls does not fit in the table.
+// Locking: acquires runtimeLock if the chain must be built
+const cxx_chain_t *
+cxxConstructChain(Class cls)
+{
+    return cxxChain(cls, true);
+}
+
+const cxx_chain_t *
+cxxDestructChain(Class cls)
+{
+    return cxxChain(cls, false);
+}
+
+// Builds cls's chains ahead of its first allocation.
+// Locking: acquires runtimeLock
+void
+cxxChainsPrepare(Class cls)
+{
+    if (!cls->hasCxxCtor()  &&  !cls->hasCxxDtor()) return;
+
+    mutex_locker_t lock(runtimeLock);
+    cxx_chain_slot_t *slot = cxxChainSlotIfNeeded_nolock(cls);
+    if (!slot) return;
+    if (cls->hasCxxCtor()) cxxChainIfNeeded_nolock(slot, cls, true);
+    if (cls->hasCxxDtor()) cxxChainIfNeeded_nolock(slot, cls, false);
+}
+
+}
+
+// Forgets cls's chains after its methods change.
+static void cxxChainsErase_nolock(Class cls)
+{
+    runtimeLock.assertLocked();
+
+    if (!cls->hasCxxCtor()  &&  !cls->hasCxxDtor()) return;
+
+    auto *slots = objc::cxxChainSlots.load(std::memory_order_relaxed);
+    if (!slots) return;
+
+    if (auto *slot = objc::cxxChainSlot(slots, cls, false)) {
+        // Leaked: another thread may be running the old chains.
+        slot->ctors.store(nil, std::memory_order_release);
+        slot->dtors.store(nil, std::memory_order_release);
+    }
+}
+
+// Frees cls's slot and chains when cls itself is freed. No instance
+// of cls can be under construction or destruction any more.
+static void cxxChainsFree_nolock(Class cls)
+{
+    runtimeLock.assertLocked();
+
+    auto *slots = objc::cxxChainSlots.load(std::memory_order_relaxed);
+    if (!slots) return;
+
+    if (auto *slot = objc::cxxChainSlot(slots, cls, false)) {
+        free(slot->ctors.exchange(nil, std::memory_order_relaxed));
+        free(slot->dtors.exchange(nil, std::memory_order_relaxed));
+        slot->cls.store(CXX_CHAIN_SLOT_FREED, std::memory_order_release);
+    }
+}
+
+
 /***********************************************************************
 * class_getProperty
 * fixme
@@ -6636,6 +7836,7 @@ objc_class::setInitialized()
     objc::AWZScanner::scanInitializedClass(cls, metacls);
     objc::RRScanner::scanInitializedClass(cls, metacls);
     objc::CoreScanner::scanInitializedClass(cls, metacls);
+    objc::DeallocScanner::scanInitializedClass(cls, metacls);
 
 #if CONFIG_USE_PREOPT_CACHES
     cls->cache.maybeConvertToPreoptimized();
@@ -6828,6 +8029,7 @@ adjustCustomFlagsForMethodChange(Class cls, method_t *meth)
     objc::AWZScanner::scanChangedMethod(cls, meth);
     objc::RRScanner::scanChangedMethod(cls, meth);
     objc::CoreScanner::scanChangedMethod(cls, meth);
+    objc::DeallocScanner::scanChangedMethod(cls, meth);
 }
 
 
@@ -7041,11 +8243,13 @@ addMethods_finish(Class cls, method_list_t *newlist)
     // If the class being modified has a constant cache,
     // then all children classes are flattened constant caches
     // and need to be flushed as well.
+    flush_selectors_t sels;
+    sels.add(newlist);
     flushCaches(cls, __func__, [](Class c){
         // constant caches have been dealt with in prepareMethodLists
         // if the class still is constant here, it's fine to keep
         return !c->cache.isConstantOptimizedCache();
-    });
+    }, sels.sels(), sels.count());
 }
 
 
@@ -7820,6 +9024,9 @@ static void detach_class(Class cls, bool isMeta)
         removeNamedClass(cls, cls->mangledName());
     }
     objc::allocatedClasses.get().erase(cls);
+
+    negativeLookupFilterErase_nolock(cls);
+    cxxChainsFree_nolock(cls);
 }
 
 
@@ -7846,6 +9053,7 @@ static void free_class(Class cls)
             try_free(meth.types());
         }
         rwe->methods.tryFree();
+        free(rwe->methodIndex);
     }
     
     const ivar_list_t *ivars = ro->ivars;
@@ -7987,7 +9195,15 @@ _class_createInstanceFromZone(Class cls, size_t extraBytes, void *zone,
     if (zone) {
         obj = (id)malloc_zone_calloc((malloc_zone_t *)zone, 1, size);
     } else {
-        obj = (id)calloc(1, size);
+        obj = nil;
+#if SUPPORT_SEGREGATED_ALLOC
+        if (slowpath(construct_flags & OBJECT_CONSTRUCT_DEFAULT_ALLOC)  &&
+            !cls->hasCustomDealloc())
+        {
+            obj = (id)objc::slabAlloc(size);
+        }
+#endif
+        if (fastpath(!obj)) obj = (id)calloc(1, size);
     }
     if (slowpath(!obj)) {
         if (construct_flags & OBJECT_CONSTRUCT_CALL_BADALLOC) {
@@ -8005,6 +9221,15 @@ _class_createInstanceFromZone(Class cls, size_t extraBytes, void *zone,
     }
 
     if (fastpath(!hasCxxCtor)) {
+#if ISA_HAS_BIASED_RC_BIT
+        // Objects whose C++ constructors can fail are never biased.
+        if (slowpath(DeferredRC)  &&  !zone  &&  fast  &&
+            (construct_flags & OBJECT_CONSTRUCT_DEFAULT_ALLOC)  &&
+            !cls->hasCustomRR())
+        {
+            objc::rcBiasAdopt(obj);
+        }
+#endif
         return obj;
     }
 
@@ -8025,17 +9250,86 @@ _objc_rootAllocWithZone(Class cls, malloc_zone_t *zone __unused)
 {
     // allocWithZone under __OBJC2__ ignores the zone parameter
     return _class_createInstanceFromZone(cls, 0, nil,
-                                         OBJECT_CONSTRUCT_CALL_BADALLOC);
+                                         OBJECT_CONSTRUCT_CALL_BADALLOC |
+                                         OBJECT_CONSTRUCT_DEFAULT_ALLOC);
+}
+
+/***********************************************************************
+* _class_createInstancesFromZone
+* Batch-allocating version of _class_createInstanceFromZone.
+* Attempts to allocate num_requested objects, each with extraBytes.
+* Returns the number of allocated objects (possibly zero), with 
+* the allocated pointers in *results.
+* Without a zone the objects get nonpointer isas, as in 
+* _class_createInstanceFromZone.
+**********************************************************************/
+unsigned
+_class_createInstancesFromZone(Class cls, size_t extraBytes, void *zone, 
+                               id *results, unsigned num_requested,
+                               int construct_flags)
+{
+    if (!cls  ||  num_requested == 0) return 0;
+    ASSERT(cls->isRealized());
+
+    // Read class's info bits all at once for performance
+    bool hasCxxCtor = cls->hasCxxCtor();
+    bool hasCxxDtor = cls->hasCxxDtor();
+    bool fast = cls->canAllocNonpointer();
+    size_t size = cls->instanceSize(extraBytes);
+
+    unsigned num_allocated = 0;
+#if SUPPORT_SEGREGATED_ALLOC
+    if (!zone  &&  (construct_flags & OBJECT_CONSTRUCT_DEFAULT_ALLOC)  &&
+        !cls->hasCustomDealloc())
+    {
+        num_allocated = objc::slabAllocBatch(size, (void **)results,
+                                             num_requested);
+    }
+#endif
+    if (num_allocated < num_requested) {
+        malloc_zone_t *mzone = (malloc_zone_t *)(zone ?: malloc_default_zone());
+        unsigned count =
+            malloc_zone_batch_malloc(mzone, size, (void **)results + num_allocated,
+                                     num_requested - num_allocated);
+        for (unsigned i = num_allocated; i < num_allocated + count; i++) {
+            bzero(results[i], size);
+        }
+        num_allocated += count;
+    }
+
+    if (!zone && fast) {
+        for (unsigned i = 0; i < num_allocated; i++) {
+            results[i]->initInstanceIsa(cls, hasCxxDtor);
+        }
+    } else {
+        // Use raw pointer isa on the assumption that they might be
+        // doing something weird with the zone or RR.
+        for (unsigned i = 0; i < num_allocated; i++) {
+            results[i]->initIsa(cls);
+        }
+    }
+
+    if (fastpath(!hasCxxCtor)) {
+#if ISA_HAS_BIASED_RC_BIT
+        if (slowpath(DeferredRC)  &&  !zone  &&  fast  &&
+            (construct_flags & OBJECT_CONSTRUCT_DEFAULT_ALLOC)  &&
+            !cls->hasCustomRR())
+        {
+            for (unsigned i = 0; i < num_allocated; i++) {
+                objc::rcBiasAdopt(results[i]);
+            }
+        }
+#endif
+        return num_allocated;
+    }
+
+    return object_cxxConstructBatchFromClass(results, num_allocated, cls);
 }
 
 /***********************************************************************
 * class_createInstances
-* fixme
 * Locking: none
 **********************************************************************/
-#if SUPPORT_NONPOINTER_ISA
-#warning fixme optimize class_createInstances
-#endif
 unsigned 
 class_createInstances(Class cls, size_t extraBytes, 
                       id *results, unsigned num_requested)
@@ -8154,7 +9448,7 @@ object_dispose(id obj)
     if (!obj) return nil;
     // 销毁实例
     objc_destructInstance(obj);
-    free(obj);
+    objc::freeInstanceMemory(obj);
 
     return nil;
 }
@@ -539,6 +539,7 @@ void _objc_pthread_destroyspecific(void *arg)
             }
         }
         free(data->classNameLookups);
+        _destroyTrampolineCache(data->trampolineCache);
 
         // add further cleanup here...
 
@@ -124,6 +124,25 @@ static SEL __sel_registerName(const char *name, bool shouldLock, bool copy)
 }
 
 
+/***********************************************************************
+* sel_lookUpNameNoLock
+* Returns the registered selector named name, or nil if there is none.
+* Never registers a selector.
+* Locking: the caller must hold selLock, or otherwise guarantee that no
+* selectors are registered while this runs. _read_images calls this
+* from worker threads while the thread that started them holds selLock.
+**********************************************************************/
+SEL sel_lookUpNameNoLock(const char *name)
+{
+    SEL result = search_builtins(name);
+    if (result) return result;
+
+    auto it = namedSelectors.get().find(name);
+    if (it != namedSelectors.get().end()) return (SEL)*it;
+    return nil;
+}
+
+
 SEL sel_registerName(const char *name) {
     return __sel_registerName(name, 1, 1);     // YES lock, YES copy
 }
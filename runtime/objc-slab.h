@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2021 Apple Inc.  All Rights Reserved.
+ * 
+ * @APPLE_LICENSE_HEADER_START@
+ * 
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ * 
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ * 
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/**
+ * @file objc-slab.h
+ *
+ * Size-segregated allocator for small object instances.
+ *
+ * When OBJC_SEGREGATED_ALLOC is set, +alloc of a class that uses the
+ * default +alloc and -dealloc and whose instances are at most 
+ * slabMaxSize bytes takes its memory from 16-byte size classes carved 
+ * out of one reserved VM region, instead of calloc().
+ *
+ * Each thread keeps a free list per size class. Objects freed on any
+ * thread go to that thread's list, and lists that grow too long hand 
+ * a magazine of objects back to a global per-size-class depot, so
+ * memory freed on one thread is reused by the others. Slab memory is
+ * never returned to the system.
+ *
+ * Objects in the region are recognized by address, so instance memory
+ * must be released with freeInstanceMemory() rather than free().
+ *
+ * Included by objc-private.h.
+ */
+
+#ifndef _OBJC_SLAB_H
+#define _OBJC_SLAB_H
+
+namespace objc {
+
+#if SUPPORT_SEGREGATED_ALLOC
+
+static constexpr size_t slabMaxSize = 256;
+static constexpr size_t slabRegionSize = 256 * 1024 * 1024;
+
+// Base address of the slab region, or 0 if it is not reserved.
+extern uintptr_t slabRegionBase;
+
+extern void slabInit(void);
+extern void *slabAlloc(size_t size);
+extern unsigned slabAllocBatch(size_t size, void **results, unsigned count);
+extern void slabFree(void *ptr);
+
+static ALWAYS_INLINE bool
+slabContains(const void *ptr)
+{
+    uintptr_t base = slabRegionBase;
+    return base  &&  (uintptr_t)ptr - base < slabRegionSize;
+}
+
+#endif
+
+// Frees the memory of an object instance allocated by
+// _class_createInstanceFromZone() without a zone.
+static ALWAYS_INLINE void
+freeInstanceMemory(void *ptr)
+{
+#if SUPPORT_SEGREGATED_ALLOC
+    if (slowpath(slabContains(ptr))) {
+        slabFree(ptr);
+        return;
+    }
+#endif
+    free(ptr);
+}
+
+} // namespace objc
+
+#endif
@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2021 Apple Inc.  All Rights Reserved.
+ * 
+ * @APPLE_LICENSE_HEADER_START@
+ * 
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ * 
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ * 
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/**
+ * @file objc-slab.mm
+ *
+ * Size-segregated allocator for small object instances.
+ * See objc-slab.h.
+ */
+
+#include "objc-private.h"
+#include "objc-zalloc.h"
+
+#if SUPPORT_SEGREGATED_ALLOC
+
+#include <mach/mach.h>
+
+namespace objc {
+
+// Slabs are carved out of the region in order and never released.
+// Each slab holds objects of one size class.
+static constexpr size_t slabShift = 14;
+static constexpr size_t slabSize = 1 << slabShift;
+static constexpr size_t slabCount = slabRegionSize / slabSize;
+
+// Size class i holds objects of (i+1)*16 bytes.
+static constexpr size_t slabGranule = 16;
+static constexpr unsigned slabSizeClassCount = slabMaxSize / slabGranule;
+
+// A thread's list longer than twice this hands this many objects 
+// to the depot.
+static constexpr uint32_t slabMagazineSize = 64;
+
+uintptr_t slabRegionBase;
+static std::atomic<uint32_t> slabNextIndex;
+// 1 + size class of each carved slab
+static uint8_t slabSizeClasses[slabCount];
+
+// Free objects are linked through their second word. The first word
+// links magazines in the depot (see AtomicQueue).
+struct slab_free_t {
+    slab_free_t *depotNext;
+    slab_free_t *next;
+};
+
+struct slab_list_t {
+    slab_free_t *head;
+    uint32_t count;
+};
+
+struct slab_thread_cache_t {
+    slab_list_t lists[slabSizeClassCount];
+};
+
+static AtomicQueue slabDepot[slabSizeClassCount];
+
+
+static inline unsigned
+slabSizeClassForSize(size_t size)
+{
+    return (unsigned)((size + slabGranule - 1) / slabGranule) - 1;
+}
+
+static inline size_t
+slabSizeForSizeClass(unsigned sc)
+{
+    return (sc + 1) * slabGranule;
+}
+
+
+/***********************************************************************
+* slabThreadCacheDestroy
+* Thread exit: hands the thread's free lists back to the depot.
+**********************************************************************/
+static void
+slabThreadCacheDestroy(void *arg)
+{
+    auto *cache = (slab_thread_cache_t *)arg;
+    if (!cache) return;
+
+    for (unsigned sc = 0; sc < slabSizeClassCount; sc++) {
+        if (cache->lists[sc].head) {
+            slabDepot[sc].push(cache->lists[sc].head);
+        }
+    }
+    free(cache);
+}
+
+static ALWAYS_INLINE slab_thread_cache_t *
+slabThreadCache()
+{
+    auto *cache = (slab_thread_cache_t *)tls_get_direct(SLAB_CACHE_DIRECT_KEY);
+    if (slowpath(!cache)) {
+        cache = (slab_thread_cache_t *)calloc(1, sizeof(*cache));
+        tls_set_direct(SLAB_CACHE_DIRECT_KEY, cache);
+    }
+    return cache;
+}
+
+
+/***********************************************************************
+* slabInit
+* Reserves the slab region. Called once at startup when 
+* OBJC_SEGREGATED_ALLOC is set. Pages are only touched as slabs 
+* are carved.
+**********************************************************************/
+void
+slabInit(void)
+{
+    vm_address_t base = 0;
+    kern_return_t kr = vm_allocate(mach_task_self(), &base, slabRegionSize,
+                                   VM_FLAGS_ANYWHERE | VM_MAKE_TAG(VM_MEMORY_FOUNDATION));
+    if (kr != KERN_SUCCESS) {
+        // Everything falls back to calloc().
+        return;
+    }
+
+    int r __unused = pthread_key_init_np(SLAB_CACHE_DIRECT_KEY,
+                                         &slabThreadCacheDestroy);
+    ASSERT(r == 0);
+
+    slabRegionBase = (uintptr_t)base;
+}
+
+
+/***********************************************************************
+* slabRefill
+* Fills an empty thread list with a magazine from the depot or, 
+* failing that, with a new slab. Returns false if the region is full.
+**********************************************************************/
+static NEVER_INLINE bool
+slabRefill(slab_list_t &list, unsigned sc)
+{
+    if (auto *head = (slab_free_t *)slabDepot[sc].pop()) {
+        uint32_t count = 0;
+        for (auto *e = head; e; e = e->next) count++;
+        list.head = head;
+        list.count = count;
+        return true;
+    }
+
+    uint32_t index = slabNextIndex.fetch_add(1, std::memory_order_relaxed);
+    if (index >= slabCount) {
+        slabNextIndex.store(slabCount, std::memory_order_relaxed);
+        return false;
+    }
+    slabSizeClasses[index] = (uint8_t)(sc + 1);
+
+    size_t size = slabSizeForSizeClass(sc);
+    uint32_t count = (uint32_t)(slabSize / size);
+    uintptr_t slab = slabRegionBase + (index << slabShift);
+    slab_free_t *next = nil;
+    for (uint32_t i = count; i > 0; i--) {
+        auto *e = (slab_free_t *)(slab + (i - 1) * size);
+        e->next = next;
+        next = e;
+    }
+    list.head = next;
+    list.count = count;
+    return true;
+}
+
+
+/***********************************************************************
+* slabAlloc
+* Returns zeroed memory for an object of the given size, or nil if the
+* size is too big or the region is exhausted.
+**********************************************************************/
+void *
+slabAlloc(size_t size)
+{
+    void *result;
+    return slabAllocBatch(size, &result, 1) ? result : nil;
+}
+
+
+/***********************************************************************
+* slabAllocBatch
+* Fills results with up to count zeroed blocks for objects of the 
+* given size. Returns the number of blocks allocated.
+**********************************************************************/
+unsigned
+slabAllocBatch(size_t size, void **results, unsigned count)
+{
+    if (!slabRegionBase  ||  size > slabMaxSize) return 0;
+
+    unsigned sc = slabSizeClassForSize(size);
+    slab_list_t &list = slabThreadCache()->lists[sc];
+
+    unsigned n = 0;
+    while (n < count) {
+        if (slowpath(!list.head)  &&  !slabRefill(list, sc)) break;
+        slab_free_t *e = list.head;
+        list.head = e->next;
+        list.count--;
+        results[n++] = e;
+    }
+
+    // The rest of each block past `size` is never read by its object.
+    for (unsigned i = 0; i < n; i++) {
+        bzero(results[i], size);
+    }
+    return n;
+}
+
+
+/***********************************************************************
+* slabFree
+* Returns an object's memory to this thread's list for its size class.
+**********************************************************************/
+void
+slabFree(void *ptr)
+{
+    ASSERT(slabContains(ptr));
+
+    uintptr_t offset = (uintptr_t)ptr - slabRegionBase;
+    unsigned sc = slabSizeClasses[offset >> slabShift] - 1;
+    ASSERT(sc < slabSizeClassCount);
+
+    slab_list_t &list = slabThreadCache()->lists[sc];
+    auto *e = (slab_free_t *)ptr;
+    e->next = list.head;
+    list.head = e;
+    list.count++;
+
+    if (slowpath(list.count >= 2 * slabMagazineSize)) {
+        // Keep the most recently freed objects, which are likely still
+        // in this CPU's cache, and hand the older ones to the depot.
+        slab_free_t *last = e;
+        for (uint32_t i = 1; i < slabMagazineSize; i++) last = last->next;
+        slab_free_t *older = last->next;
+        last->next = nil;
+        list.count = slabMagazineSize;
+        slabDepot[sc].push(older);
+    }
+}
+
+} // namespace objc
+
+#endif
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2021 Apple Inc.  All Rights Reserved.
+ * 
+ * @APPLE_LICENSE_HEADER_START@
+ * 
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ * 
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ * 
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/**
+ * @file objc-trace.h
+ *
+ * Startup tracing for objc.
+ *
+ * When OBJC_RECORD_TRACE is set, image mapping, the phases of
+ * _read_images, category attachment, class realization, +load and
+ * +initialize record their begin and end times into a fixed-size ring 
+ * buffer. _objc_copyTraceJSON() exports the buffer in the Chrome trace
+ * event format.
+ *
+ * Included by objc-private.h.
+ */
+
+#ifndef _OBJC_TRACE_H
+#define _OBJC_TRACE_H
+
+namespace objc {
+
+// Records one complete event. category must stay valid for the life
+// of the process. name is copied.
+// Locking: acquires InternedStringLock
+extern void traceRecord(const char *category, const char *name,
+                        uint64_t start, uint64_t end);
+
+// Records the lifetime of a scope as one trace event.
+// The name function is only called when tracing is enabled, so
+// it may do work that is too expensive for the untraced path.
+class TraceScope {
+    uint64_t mStart;
+    const char *mCategory;
+    const char *mName;
+    bool mRecord;
+
+ public:
+    TraceScope(const char *category, const char *name)
+     : mStart(0), mCategory(category), mName(name), mRecord(RecordTrace)
+    {
+        if (slowpath(mRecord)) mStart = nanoseconds();
+    }
+
+    template <typename NameFn>
+    TraceScope(const char *category, const NameFn &nameFn)
+     : mStart(0), mCategory(category), mName(nullptr), mRecord(RecordTrace)
+    {
+        if (slowpath(mRecord)) {
+            mName = nameFn();
+            mStart = nanoseconds();
+        }
+    }
+
+    ~TraceScope() {
+        if (slowpath(mRecord)) {
+            traceRecord(mCategory, mName, mStart, nanoseconds());
+        }
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator =(const TraceScope &) = delete;
+};
+
+} // namespace objc
+
+#endif
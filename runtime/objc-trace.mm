@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2021 Apple Inc.  All Rights Reserved.
+ * 
+ * @APPLE_LICENSE_HEADER_START@
+ * 
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ * 
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ * 
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/***********************************************************************
+* objc-trace.mm
+* Ring buffer of startup trace events and its Chrome trace export.
+**********************************************************************/
+
+#include "objc-private.h"
+#include "DenseMapExtras.h"
+
+#include <atomic>
+
+namespace objc {
+
+// Must be a power of two. Once full, the oldest events are overwritten.
+static constexpr uint32_t TraceBufferCount = 16384;
+
+struct TraceEntry {
+    // Index of the event plus one once it is completely written,
+    // zero while it is being written.
+    std::atomic<uint64_t> seq;
+    uint64_t start;
+    uint64_t end;
+    uint64_t tid;
+    const char *category;
+    const char *name;
+};
+
+static std::atomic<TraceEntry *> traceBuffer;
+static std::atomic<uint64_t> traceNext;
+
+static TraceEntry *traceBufferIfNeeded()
+{
+    TraceEntry *buffer = traceBuffer.load(std::memory_order_acquire);
+    if (slowpath(!buffer)) {
+        TraceEntry *newBuffer = (TraceEntry *)
+            calloc(TraceBufferCount, sizeof(TraceEntry));
+        if (traceBuffer.compare_exchange_strong(buffer, newBuffer,
+                                                std::memory_order_acq_rel))
+        {
+            buffer = newBuffer;
+        } else {
+            free(newBuffer);
+        }
+    }
+    return buffer;
+}
+
+// Names come from images and classes that may be unloaded or freed
+// before the trace is exported. Each distinct name is copied once and
+// kept for the life of the process.
+static LazyInitDenseSet<const char *> traceNames;
+
+static const char *traceName(const char *name)
+{
+    if (!name) return nullptr;
+
+    mutex_locker_t lock(InternedStringLock);
+    auto& names = *traceNames.get(true);
+    auto it = names.find(name);
+    if (it != names.end()) return *it;
+
+    const char *copy = strdup(name);
+    names.insert(copy);
+    return copy;
+}
+
+void traceRecord(const char *category, const char *name,
+                 uint64_t start, uint64_t end)
+{
+    TraceEntry *buffer = traceBufferIfNeeded();
+    name = traceName(name);
+
+    uint64_t index = traceNext.fetch_add(1, std::memory_order_relaxed);
+    TraceEntry &entry = buffer[index & (TraceBufferCount - 1)];
+
+    entry.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    entry.start = start;
+    entry.end = end;
+    pthread_threadid_np(nullptr, &entry.tid);
+    entry.category = category;
+    entry.name = name;
+    entry.seq.store(index + 1, std::memory_order_release);
+}
+
+
+// Growable string for building the JSON export.
+class TraceWriter {
+    char *mBuf;
+    size_t mLen;
+    size_t mCap;
+
+ public:
+    TraceWriter() : mBuf(nullptr), mLen(0), mCap(0) { }
+
+    void append(const char *str, size_t len) {
+        if (mLen + len + 1 > mCap) {
+            mCap = MAX(mCap * 2, mLen + len + 1);
+            mBuf = (char *)realloc(mBuf, mCap);
+        }
+        memcpy(mBuf + mLen, str, len);
+        mLen += len;
+        mBuf[mLen] = '\0';
+    }
+
+    void append(const char *str) {
+        append(str, strlen(str));
+    }
+
+    void appendf(const char *fmt, ...) __attribute__((format(printf, 2, 3))) {
+        char buf[256];
+        va_list ap;
+        va_start(ap, fmt);
+        int len = vsnprintf(buf, sizeof(buf), fmt, ap);
+        va_end(ap);
+        append(buf, MIN((size_t)len, sizeof(buf) - 1));
+    }
+
+    void appendJSONString(const char *str) {
+        append("\"", 1);
+        for (const char *c = str; *c; c++) {
+            if (*c == '"'  ||  *c == '\\') {
+                char escaped[2] = { '\\', *c };
+                append(escaped, 2);
+            } else if ((unsigned char)*c < 0x20) {
+                appendf("\\u%04x", (unsigned char)*c);
+            } else {
+                append(c, 1);
+            }
+        }
+        append("\"", 1);
+    }
+
+    char *take() {
+        char *result = mBuf;
+        mBuf = nullptr;
+        mLen = mCap = 0;
+        return result;
+    }
+};
+
+} // namespace objc
+
+using namespace objc;
+
+
+/***********************************************************************
+* _objc_copyTraceJSON
+* Returns the recorded trace events in Chrome trace event format.
+* Events being written concurrently are skipped.
+* Locking: none
+**********************************************************************/
+char *
+_objc_copyTraceJSON(void)
+{
+    if (!RecordTrace) return nil;
+
+    TraceEntry *buffer = traceBufferIfNeeded();
+    uint64_t next = traceNext.load(std::memory_order_acquire);
+    uint64_t first = next > TraceBufferCount ? next - TraceBufferCount : 0;
+    int pid = getpid();
+
+    TraceWriter writer;
+    writer.append("{\"traceEvents\":[");
+
+    bool needsComma = false;
+    for (uint64_t index = first; index < next; index++) {
+        TraceEntry &entry = buffer[index & (TraceBufferCount - 1)];
+        if (entry.seq.load(std::memory_order_acquire) != index + 1) continue;
+
+        uint64_t start = entry.start;
+        uint64_t end = entry.end;
+        uint64_t tid = entry.tid;
+        const char *category = entry.category;
+        const char *name = entry.name;
+
+        // Skip the entry if it was overwritten while we read it.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (entry.seq.load(std::memory_order_relaxed) != index + 1) continue;
+
+        if (needsComma) writer.append(",");
+        needsComma = true;
+
+        writer.append("{\"name\":");
+        writer.appendJSONString(name ?: category);
+        writer.append(",\"cat\":");
+        writer.appendJSONString(category);
+        writer.appendf(",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                       "\"pid\":%d,\"tid\":%llu}",
+                       start / 1000.0, (end - start) / 1000.0,
+                       pid, (unsigned long long)tid);
+    }
+
+    writer.append("],\"displayTimeUnit\":\"ms\"}");
+    return writer.take();
+}
@@ -27,6 +27,7 @@
 **********************************************************************/
 
 #include "objc-private.h"
+#include "DenseMapExtras.h"
 
 /***********************************************************************
 * SubtypeUntil.
@@ -104,62 +105,155 @@ static const char *	SkipFirstType	   (const char *	type)
 
 
 /***********************************************************************
-* encoding_getNumberOfArguments.
+* Parsed method signatures.
+* Bridging and forwarding code asks for the arguments of the same few 
+* method types over and over, and every query used to re-parse the 
+* type string. Each distinct type string is now parsed once into an 
+* objc_method_signature, which is interned by the string's contents 
+* and never freed. The signature holds its own copy of the string, so 
+* it outlives an unloaded image that supplied the original.
+*
+* Repeated queries with the same type string pointer skip the lock; 
+* see objc::InternedStringCache.
+* Locking: InternedStringLock protects the interned signatures
 **********************************************************************/
-unsigned int 
-encoding_getNumberOfArguments(const char *typedesc)
+static objc::InternedStringCache<objc_method_signature, 
+                                 &objc_method_signature::types, 256>
+    MethodSignatures;
+
+// Returns typedesc's argument count without recording anything.
+static unsigned
+countArguments(const char *typedesc)
 {
-    unsigned nargs;
+    unsigned nargs = 0;
 
-    // First, skip the return type
     typedesc = SkipFirstType (typedesc);
-
-    // Next, skip stack size
     while ((*typedesc >= '0') && (*typedesc <= '9'))
         typedesc += 1;
 
-    // Now, we have the arguments - count how many
-    nargs = 0;
     while (*typedesc)
     {
-        // Traverse argument type
         typedesc = SkipFirstType (typedesc);
-
-        // Skip GNU runtime's register parameter hint
         if (*typedesc == '+') typedesc++;
-
-        // Traverse (possibly negative) argument offset
         if (*typedesc == '-')
             typedesc += 1;
         while ((*typedesc >= '0') && (*typedesc <= '9'))
             typedesc += 1;
-
-        // Made it past an argument
         nargs += 1;
     }
 
     return nargs;
 }
 
+// Returns the type code of type, skipping any qualifiers.
+static char
+typeCode(const char *type)
+{
+    while (*type  &&  strchr("rnNoORV", *type)) type++;
+    return *type;
+}
+
+// Returns a (possibly negative) decimal number, advancing *typedesc.
+static int
+parseOffset(const char **typedesc)
+{
+    const char *t = *typedesc;
+    bool negative = false;
+    int value = 0;
+
+    // Skip GNU runtime's register parameter hint
+    if (*t == '+') t++;
+    if (*t == '-') {
+        negative = true;
+        t++;
+    }
+    while ((*t >= '0') && (*t <= '9'))
+        value = value * 10 + (*t++ - '0');
+
+    *typedesc = t;
+    return negative ? -value : value;
+}
+
+// Parses typedesc into a single allocation holding the signature,
+// a copy of typedesc, and a NUL-terminated copy of each type.
+static objc_method_signature *
+parseSignature(const char *typedesc)
+{
+    unsigned nargs = countArguments(typedesc);
+    size_t typesLength = strlen(typedesc) + 1;
+
+    // The types are disjoint pieces of typedesc, so their copies
+    // need no more than typedesc's length plus a NUL for each.
+    size_t size = sizeof(objc_method_signature) + 
+        nargs * sizeof(objc_method_argument) + 
+        typesLength + typesLength + nargs + 1;
+    auto sig = (objc_method_signature *)calloc(1, size);
+    char *strings = (char *)&sig->arguments[nargs];
+
+    memcpy(strings, typedesc, typesLength);
+    sig->types = strings;
+    char *copies = strings + typesLength;
+
+    auto copyType = [&](const char *start, const char *end) {
+        const char *copy = copies;
+        memcpy(copies, start, end - start);
+        copies += end - start + 1;
+        return copy;
+    };
+
+    const char *t = sig->types;
+    const char *end = SkipFirstType(t);
+    sig->returnType = copyType(t, end);
+    sig->returnCode = typeCode(t);
+    t = end;
+
+    while ((*t >= '0') && (*t <= '9'))
+        sig->frameSize = (sig->frameSize * 10) + (*t++ - '0');
+
+    int selfOffset = 0;
+    for (unsigned i = 0; i < nargs; i++) {
+        objc_method_argument& arg = sig->arguments[i];
+        end = SkipFirstType(t);
+        arg.type = copyType(t, end);
+        arg.position = (uint32_t)(t - sig->types);
+        arg.code = typeCode(t);
+        t = end;
+
+        int offset = parseOffset(&t);
+        if (i == 0) selfOffset = offset;
+        else arg.offset = offset - selfOffset;
+    }
+    sig->argumentCount = nargs;
+
+    return sig;
+}
+
+const objc_method_signature *
+_objc_getMethodSignature(const char *typedesc)
+{
+    if (!typedesc) return nil;
+    return MethodSignatures.get(InternedStringLock, typedesc, parseSignature);
+}
+
+
+/***********************************************************************
+* encoding_getNumberOfArguments.
+**********************************************************************/
+unsigned int 
+encoding_getNumberOfArguments(const char *typedesc)
+{
+    const objc_method_signature *sig = _objc_getMethodSignature(typedesc);
+    return sig ? sig->argumentCount : 0;
+}
+
 /***********************************************************************
 * encoding_getSizeOfArguments.
 **********************************************************************/
 unsigned 
 encoding_getSizeOfArguments(const char *typedesc)
 {
-    unsigned		stack_size;
-
-    // Get our starting points
-    stack_size = 0;
-
-    // Skip the return type
-    typedesc = SkipFirstType (typedesc);
-
-    // Convert ASCII number string to integer
-    while ((*typedesc >= '0') && (*typedesc <= '9'))
-        stack_size = (stack_size * 10) + (*typedesc++ - '0');
-
-    return stack_size;
+    const objc_method_signature *sig = _objc_getMethodSignature(typedesc);
+    return sig ? sig->frameSize : 0;
 }
 
 
@@ -170,103 +264,18 @@ unsigned int
 encoding_getArgumentInfo(const char *typedesc, unsigned int arg,
                          const char **type, int *offset)
 {
-    unsigned nargs = 0;
-    int self_offset = 0;
-    bool offset_is_negative = NO;
-
-    // First, skip the return type
-    typedesc = SkipFirstType (typedesc);
-
-    // Next, skip stack size
-    while ((*typedesc >= '0') && (*typedesc <= '9'))
-        typedesc += 1;
+    const objc_method_signature *sig = _objc_getMethodSignature(typedesc);
 
-    // Now, we have the arguments - position typedesc to the appropriate argument
-    while (*typedesc && nargs != arg)
-    {
-
-        // Skip argument type
-        typedesc = SkipFirstType (typedesc);
-
-        if (nargs == 0)
-        {
-            // Skip GNU runtime's register parameter hint
-            if (*typedesc == '+') typedesc++;
-
-            // Skip negative sign in offset
-            if (*typedesc == '-')
-            {
-                offset_is_negative = YES;
-                typedesc += 1;
-            }
-            else
-                offset_is_negative = NO;
-
-            while ((*typedesc >= '0') && (*typedesc <= '9'))
-                self_offset = self_offset * 10 + (*typedesc++ - '0');
-            if (offset_is_negative)
-                self_offset = -(self_offset);
-
-        }
-
-        else
-        {
-            // Skip GNU runtime's register parameter hint
-            if (*typedesc == '+') typedesc++;
-
-            // Skip (possibly negative) argument offset
-            if (*typedesc == '-')
-                typedesc += 1;
-            while ((*typedesc >= '0') && (*typedesc <= '9'))
-                typedesc += 1;
-        }
-
-        nargs += 1;
+    if (sig  &&  arg < sig->argumentCount) {
+        // Point into the caller's string, as before.
+        *type = typedesc + sig->arguments[arg].position;
+        *offset = sig->arguments[arg].offset;
+        return arg;
     }
 
-    if (*typedesc)
-    {
-        int arg_offset = 0;
-
-        *type	 = typedesc;
-        typedesc = SkipFirstType (typedesc);
-
-        if (arg == 0)
-        {
-            *offset = 0;
-        }
-
-        else
-        {
-            // Skip GNU register parameter hint
-            if (*typedesc == '+') typedesc++;
-
-            // Pick up (possibly negative) argument offset
-            if (*typedesc == '-')
-            {
-                offset_is_negative = YES;
-                typedesc += 1;
-            }
-            else
-                offset_is_negative = NO;
-
-            while ((*typedesc >= '0') && (*typedesc <= '9'))
-                arg_offset = arg_offset * 10 + (*typedesc++ - '0');
-            if (offset_is_negative)
-                arg_offset = - arg_offset;
-
-            *offset = arg_offset - self_offset;
-        }
-
-    }
-
-    else
-    {
-        *type	= 0;
-        *offset	= 0;
-    }
-
-    return nargs;
+    *type	= 0;
+    *offset	= 0;
+    return sig ? sig->argumentCount : 0;
 }
 
 
@@ -274,7 +283,6 @@ void
 encoding_getReturnType(const char *t, char *dst, size_t dst_len)
 {
     size_t len;
-    const char *end;
 
     if (!dst) return;
     if (!t) {
@@ -282,8 +290,8 @@ encoding_getReturnType(const char *t, char *dst, size_t dst_len)
         return;
     }
 
-    end = SkipFirstType(t);
-    len = end - t;
+    t = _objc_getMethodSignature(t)->returnType;
+    len = strlen(t);
     strncpy(dst, t, MIN(len, dst_len));
     if (len < dst_len) memset(dst+len, 0, dst_len - len);
 }
@@ -295,18 +303,9 @@ encoding_getReturnType(const char *t, char *dst, size_t dst_len)
 char *
 encoding_copyReturnType(const char *t)
 {
-    size_t len;
-    const char *end;
-    char *result;
-
     if (!t) return NULL;
 
-    end = SkipFirstType(t);
-    len = end - t;
-    result = (char *)malloc(len + 1);
-    strncpy(result, t, len);
-    result[len] = '\0';
-    return result;
+    return strdup(_objc_getMethodSignature(t)->returnType);
 }
 
 
@@ -315,8 +314,7 @@ encoding_getArgumentType(const char *t, unsigned int index,
                          char *dst, size_t dst_len)
 {
     size_t len;
-    const char *end;
-    int offset;
+    const objc_method_signature *sig;
 
     if (!dst) return;
     if (!t) {
@@ -324,15 +322,14 @@ encoding_getArgumentType(const char *t, unsigned int index,
         return;
     }
 
-    encoding_getArgumentInfo(t, index, &t, &offset);
-
-    if (!t) {
+    sig = _objc_getMethodSignature(t);
+    if (index >= sig->argumentCount) {
         strncpy(dst, "", dst_len);
         return;
     }
 
-    end = SkipFirstType(t);
-    len = end - t;
+    t = sig->arguments[index].type;
+    len = strlen(t);
     strncpy(dst, t, MIN(len, dst_len));
     if (len < dst_len) memset(dst+len, 0, dst_len - len);
 }
@@ -345,21 +342,12 @@ encoding_getArgumentType(const char *t, unsigned int index,
 char *
 encoding_copyArgumentType(const char *t, unsigned int index)
 {
-    size_t len;
-    const char *end;
-    char *result;
-    int offset;
+    const objc_method_signature *sig;
 
     if (!t) return NULL;
 
-    encoding_getArgumentInfo(t, index, &t, &offset);
-
-    if (!t) return NULL;
+    sig = _objc_getMethodSignature(t);
+    if (index >= sig->argumentCount) return NULL;
 
-    end = SkipFirstType(t);
-    len = end - t;
-    result = (char *)malloc(len + 1);
-    strncpy(result, t, len);
-    result[len] = '\0';
-    return result;
+    return strdup(sig->arguments[index].type);
 }
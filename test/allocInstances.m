@@ -0,0 +1,73 @@
+// TEST_CONFIG MEM=mrc
+
+// objc_allocInstances() and class_createInstances() allocate in batches
+// and give the new objects nonpointer isas.
+
+#include "test.h"
+#include <objc/NSObject.h>
+#include <objc/objc-internal.h>
+
+int initializes;
+
+@interface Pooled : NSObject {
+@public
+    long a, b, c;
+}
+@end
+@implementation Pooled
++(void)initialize { if (self == [Pooled class]) initializes++; }
+@end
+
+int allocs;
+@interface CustomAlloc : NSObject @end
+@implementation CustomAlloc
++(id)alloc { allocs++; return [super alloc]; }
+@end
+
+#define COUNT 1000
+
+static void check(id obj, Class cls)
+{
+    testassert(object_getClass(obj) == cls);
+#if __LP64__
+    // Nonpointer isas have the low bit set.
+    testassert(*(uintptr_t *)obj & 1);
+#endif
+    testassert([obj retainCount] == 1);
+    [obj retain];
+    testassert([obj retainCount] == 2);
+    [obj release];
+}
+
+int main()
+{
+    static id objs[COUNT];
+
+    unsigned n = objc_allocInstances([Pooled class], objs, COUNT);
+    testassert(n == COUNT);
+    testassert(initializes == 1);
+    for (unsigned i = 0; i < n; i++) {
+        Pooled *p = [objs[i] init];
+        check(p, [Pooled class]);
+        testassert(p->a == 0  &&  p->b == 0  &&  p->c == 0);
+        for (unsigned j = 0; j < i; j++) testassert(objs[j] != p);
+    }
+    for (unsigned i = 0; i < n; i++) [objs[i] release];
+
+    // A custom +alloc is sent for every object.
+    n = objc_allocInstances([CustomAlloc class], objs, 10);
+    testassert(n == 10);
+    testassert(allocs == 10);
+    for (unsigned i = 0; i < n; i++) [[objs[i] init] release];
+
+    testassert(objc_allocInstances(Nil, objs, COUNT) == 0);
+
+    n = class_createInstances([Pooled class], 0, objs, 10);
+    testassert(n > 0);
+    for (unsigned i = 0; i < n; i++) {
+        check(objs[i], [Pooled class]);
+        [objs[i] release];
+    }
+
+    succeed(__FILE__);
+}
@@ -0,0 +1,172 @@
+// TEST_ENV OBJC_LOCK_FREE_PROPERTIES=YES
+// TEST_CONFIG MEM=mrc
+
+// With OBJC_LOCK_FREE_PROPERTIES, atomic property getters and setters
+// do not take striped spinlocks.
+// Getters racing with setters must never return a freed object, and
+// every value that is swapped out must be released exactly once. This
+// holds when a value's custom -retain runs nested getters.
+
+#include "test.h"
+#include <objc/NSObject.h>
+#include <objc/runtime.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <mach/mach_time.h>
+
+static atomic_int allocs;
+static atomic_int deallocs;
+
+@interface Value : NSObject {
+@public
+    int magic;
+}
+@end
+@implementation Value
+-(id)init { magic = 0x1234; atomic_fetch_add(&allocs, 1); return self; }
+-(void)dealloc { magic = 0; atomic_fetch_add(&deallocs, 1); [super dealloc]; }
+@end
+
+@interface Holder : NSObject
+@property(atomic, retain) id value;
+@end
+@implementation Holder
+-(void)dealloc { [_value release]; [super dealloc]; }
+@end
+
+#define THREADS 8
+#define ITERATIONS 100000
+// Deeper than one hazard record.
+#define NESTING 6
+
+static Holder *shared;
+static Holder *nested;
+static __thread int nesting;
+
+@interface NestingValue : Value @end
+@implementation NestingValue
+-(id)retain {
+    if (nesting < NESTING) {
+        nesting++;
+        @autoreleasepool {
+            Value *v = nested.value;
+            testassert(v  &&  v->magic == 0x1234);
+        }
+        nesting--;
+    }
+    return [super retain];
+}
+@end
+
+static void *getShared(void *arg __unused)
+{
+    for (int i = 0; i < ITERATIONS; i++) {
+        @autoreleasepool {
+            Value *v = shared.value;
+            testassert(v  &&  v->magic == 0x1234);
+        }
+    }
+    return NULL;
+}
+
+static void *setShared(void *arg __unused)
+{
+    for (int i = 0; i < ITERATIONS / 10; i++) {
+        Value *v = [Value new];
+        shared.value = v;
+        [v release];
+    }
+    return NULL;
+}
+
+static void *setSharedNesting(void *arg __unused)
+{
+    for (int i = 0; i < ITERATIONS / 10; i++) {
+        Value *v = [NestingValue new];
+        shared.value = v;
+        [v release];
+        v = [NestingValue new];
+        nested.value = v;
+        [v release];
+    }
+    return NULL;
+}
+
+// Each thread uses its own holder. With striped locks, unrelated
+// holders could share a lock.
+static void *getSetPrivate(void *arg __unused)
+{
+    Holder *holder = [Holder new];
+    Value *v = [Value new];
+    for (int i = 0; i < ITERATIONS; i++) {
+        @autoreleasepool {
+            holder.value = v;
+            testassert(holder.value == v);
+        }
+    }
+    [v release];
+    [holder release];
+    return NULL;
+}
+
+static double run(void *(*fn[])(void *), int count)
+{
+    pthread_t threads[THREADS];
+    uint64_t start = mach_absolute_time();
+    for (int t = 0; t < count; t++) {
+        pthread_create(&threads[t], NULL, fn[t], NULL);
+    }
+    for (int t = 0; t < count; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    uint64_t end = mach_absolute_time();
+
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    return (double)(end - start) * tb.numer / tb.denom /
+        ((double)count * ITERATIONS);
+}
+
+int main()
+{
+    shared = [Holder new];
+    Value *v = [Value new];
+    shared.value = v;
+    [v release];
+
+    // Half the threads read while the other half replace the value.
+    void *(*mixed[THREADS])(void *);
+    for (int t = 0; t < THREADS; t++) {
+        mixed[t] = (t % 2) ? &setShared : &getShared;
+    }
+    double contended = run(mixed, THREADS);
+
+    [shared release];
+    testassertequal(allocs, deallocs);
+
+    // Getters whose retain runs getters, racing with setters.
+    shared = [Holder new];
+    nested = [Holder new];
+    v = [NestingValue new];
+    shared.value = v;
+    nested.value = v;
+    [v release];
+    for (int t = 0; t < THREADS; t++) {
+        mixed[t] = (t % 2) ? &setSharedNesting : &getShared;
+    }
+    run(mixed, THREADS);
+    [shared release];
+    [nested release];
+    testassertequal(allocs, deallocs);
+
+    void *(*independent[THREADS])(void *);
+    for (int t = 0; t < THREADS; t++) independent[t] = &getSetPrivate;
+    double uncontended = run(independent, THREADS);
+    testassertequal(allocs, deallocs);
+
+    testprintf("shared property: %.1f ns per access; "
+               "private properties: %.1f ns per get and set\n",
+               contended, uncontended);
+
+    succeed(__FILE__);
+}
@@ -0,0 +1,76 @@
+// TEST_CONFIG MEM=mrc
+
+// Many threads create and remove block IMPs at once. Each trampoline
+// must be handed to only one thread at a time.
+
+#include "test.h"
+#include "testroot.i"
+#include <objc/runtime.h>
+#include <pthread.h>
+#include <Block.h>
+#include <mach/mach_time.h>
+
+#define THREADS 8
+#define PER_ROUND 100
+#define ROUNDS 500
+
+static void *churn(void *arg)
+{
+    intptr_t me = (intptr_t)arg;
+    id block = (id)Block_copy(^(id self __unused) { return me; });
+    IMP imps[PER_ROUND];
+
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i < PER_ROUND; i++) {
+            imps[i] = imp_implementationWithBlock(block);
+        }
+        // Another thread holding the same slot would have
+        // replaced the block.
+        for (int i = 0; i < PER_ROUND; i++) {
+            testassert(imp_getBlock(imps[i]) == block);
+            testassertequal(((intptr_t(*)(id, SEL))imps[i])(nil, nil), me);
+        }
+        for (int i = 0; i < PER_ROUND; i++) {
+            testassert(imp_removeBlock(imps[i]));
+        }
+    }
+
+    Block_release(block);
+    return NULL;
+}
+
+static double run(int threads)
+{
+    pthread_t th[THREADS];
+    uint64_t start = mach_absolute_time();
+    for (intptr_t t = 0; t < threads; t++) {
+        pthread_create(&th[t], NULL, &churn, (void *)t);
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(th[t], NULL);
+    }
+    uint64_t end = mach_absolute_time();
+
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    return (double)(end - start) * tb.numer / tb.denom /
+        ((double)threads * ROUNDS * PER_ROUND);
+}
+
+int main()
+{
+    double one = run(1);
+    double many = run(THREADS);
+    testprintf("create+remove per trampoline: %.1f ns on 1 thread, "
+               "%.1f ns on %d threads\n", one, many, THREADS);
+
+    // The exited threads returned their cached slots.
+    // Trampolines still work and still can't be removed twice.
+    id block = ^(id self __unused) { return (intptr_t)42; };
+    IMP imp = imp_implementationWithBlock(block);
+    testassertequal(((intptr_t(*)(id, SEL))imp)(nil, nil), 42);
+    testassert(imp_removeBlock(imp));
+    testassert(!imp_removeBlock(imp));
+
+    succeed(__FILE__);
+}
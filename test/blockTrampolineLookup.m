@@ -0,0 +1,69 @@
+// TEST_CONFIG MEM=mrc
+
+// imp_getBlock() and imp_removeBlock() find a trampoline's page
+// directly, so their cost does not grow with the number of block IMPs.
+// Removing a trampoline twice, or removing an IMP that is not a
+// trampoline, fails.
+
+#include "test.h"
+#include "testroot.i"
+#include <objc/runtime.h>
+#include <mach/mach_time.h>
+
+#define COUNT 200000
+
+static IMP imps[COUNT];
+
+static double elapsed(uint64_t start, uint64_t end)
+{
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    return (double)(end - start) * tb.numer / tb.denom / COUNT;
+}
+
+int main()
+{
+    id block = ^(id self __unused) { return 42; };
+
+    uint64_t t0 = mach_absolute_time();
+    for (int i = 0; i < COUNT; i++) {
+        imps[i] = imp_implementationWithBlock(block);
+    }
+    uint64_t t1 = mach_absolute_time();
+    for (int i = 0; i < COUNT; i++) {
+        testassert(imp_getBlock(imps[i]) == block);
+    }
+    uint64_t t2 = mach_absolute_time();
+
+    // The first and the most recent trampolines both work.
+    testassertequal(((int(*)(id, SEL))imps[0])(nil, nil), 42);
+    testassertequal(((int(*)(id, SEL))imps[COUNT-1])(nil, nil), 42);
+
+    testassert(imp_getBlock((IMP)main) == nil);
+    testassert(!imp_removeBlock((IMP)main));
+
+    // Free every other trampoline, then reuse the holes.
+    for (int i = 0; i < COUNT; i += 2) {
+        testassert(imp_removeBlock(imps[i]));
+        testassert(imp_getBlock(imps[i]) == nil);
+        testassert(!imp_removeBlock(imps[i]));
+    }
+    for (int i = 0; i < COUNT; i += 2) {
+        imps[i] = imp_implementationWithBlock(block);
+    }
+    for (int i = 0; i < COUNT; i++) {
+        testassert(imp_getBlock(imps[i]) == block);
+    }
+
+    uint64_t t3 = mach_absolute_time();
+    for (int i = 0; i < COUNT; i++) {
+        testassert(imp_removeBlock(imps[i]));
+    }
+    uint64_t t4 = mach_absolute_time();
+
+    testprintf("%d trampolines: create %.1f ns, imp_getBlock %.1f ns, "
+               "imp_removeBlock %.1f ns\n", COUNT,
+               elapsed(t0, t1), elapsed(t1, t2), elapsed(t3, t4));
+
+    succeed(__FILE__);
+}
@@ -0,0 +1,79 @@
+// TEST_CONFIG
+
+// Adding or replacing a method removes only the affected selectors
+// from the method caches of the class and its subclasses.
+
+#include "test.h"
+#include "testroot.i"
+#include <objc/runtime.h>
+#include <objc/objc-internal.h>
+
+@interface Base : TestRoot
+-(int)one;
+-(int)two;
+-(int)three;
+@end
+@implementation Base
+-(int)one { return 1; }
+-(int)two { return 2; }
+-(int)three { return 3; }
+@end
+
+@interface Sub : Base @end
+@implementation Sub @end
+
+static int replacement(id self __unused, SEL _cmd __unused) { return 42; }
+
+static IMP findInCache(Class cls, SEL sel)
+{
+    struct objc_imp_cache_entry *ents;
+    int count;
+    IMP ret = nil;
+
+    ents = class_copyImpCache(cls, &count);
+    for (int i = 0; i < count; i++) {
+        if (ents[i].sel == sel) {
+            ret = ents[i].imp;
+            break;
+        }
+    }
+    free(ents);
+    return ret;
+}
+
+int main()
+{
+    Sub *sub = [Sub new];
+    Class cls = [Sub class];
+
+    testassert([sub one] == 1);
+    testassert([sub two] == 2);
+    testassert([sub three] == 3);
+    testassert(findInCache(cls, @selector(one)));
+    testassert(findInCache(cls, @selector(two)));
+    testassert(findInCache(cls, @selector(three)));
+
+    // Override -one in the subclass.
+    testassert(class_addMethod(cls, @selector(one), (IMP)replacement, "i@:"));
+    testassert(!findInCache(cls, @selector(one)));
+    if (!getenv("OBJC_DISABLE_SCOPED_CACHE_FLUSH")) {
+        testassert(findInCache(cls, @selector(two)));
+        testassert(findInCache(cls, @selector(three)));
+    }
+    testassert([sub one] == 42);
+
+    // Replace -two in the superclass.
+    method_setImplementation(class_getInstanceMethod([Base class], @selector(two)),
+                             (IMP)replacement);
+    testassert(!findInCache(cls, @selector(two)));
+    if (!getenv("OBJC_DISABLE_SCOPED_CACHE_FLUSH")) {
+        testassert(findInCache(cls, @selector(one)));
+        testassert(findInCache(cls, @selector(three)));
+    }
+    testassert([sub two] == 42);
+    testassert([sub three] == 3);
+
+    RELEASE_VAR(sub);
+
+    succeed(__FILE__);
+}
@@ -0,0 +1,95 @@
+/*
+TEST_BUILD
+    $C{COMPILE} $DIR/categoryBatch.m -o categoryBatch.exe
+    $C{COMPILE} $DIR/categoryBatch2.m -o categoryBatch2.bundle -bundle -bundle_loader categoryBatch.exe
+    $C{COMPILE} $DIR/categoryBatch3.m -o categoryBatch3.bundle -bundle -bundle_loader categoryBatch.exe
+END
+*/
+
+// Categories loaded onto already-realized classes are attached in a batch
+// per class. Verify load order and cache invalidation still hold, and
+// time loading an image with many categories on one class.
+
+#include "test.h"
+#include "testroot.i"
+#include <dlfcn.h>
+#include <mach/mach_time.h>
+
+@interface Base : TestRoot
+-(int)value;
++(int)classValue;
+@end
+@implementation Base
+-(int)value { return 0; }
++(int)classValue { return 0; }
+@end
+
+@interface Sub : Base @end
+@implementation Sub @end
+
+@interface Other : TestRoot @end
+@implementation Other @end
+
+@interface Base (Loaded)
+-(int)added;
+@end
+@interface Sub (Loaded)
+-(int)subValue;
+@end
+@interface Other (Loaded)
+-(int)value;
+@end
+
+int main()
+{
+    Base *base = [Base new];
+    Sub *sub = [Sub new];
+    Other *other = [Other new];
+
+    // Realize the classes and fill their caches.
+    testassert([base value] == 0);
+    testassert([sub value] == 0);
+    testassert([Base classValue] == 0);
+    testassert([Sub classValue] == 0);
+    testassert(!class_respondsToSelector([Other class], @selector(value)));
+
+    void *dlh = dlopen("categoryBatch2.bundle", RTLD_LAZY);
+    testassert(dlh);
+
+    // The last category loaded wins.
+    testassert([base value] == 2);
+    testassert([sub value] == 2);
+    testassert([Base classValue] == 4);
+    testassert([Sub classValue] == 4);
+
+    testassert([base added] == 5);
+    testassert([sub added] == 5);
+    testassert([sub subValue] == 3);
+    testassert([other value] == 6);
+
+    // categoryBatch3.bundle has 200 categories on Base.
+    unsigned before;
+    free(class_copyMethodList([Base class], &before));
+    uint64_t start = mach_absolute_time();
+    void *many = dlopen("categoryBatch3.bundle", RTLD_LAZY);
+    uint64_t end = mach_absolute_time();
+    testassert(many);
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    testprintf("dlopen with 200 categories on one class: %.1f us\n",
+               (double)(end - start) * tb.numer / tb.denom / 1000);
+
+    unsigned after;
+    free(class_copyMethodList([Base class], &after));
+    testassertequal(after, before + 400);
+    testassertequal(((int(*)(id, SEL))objc_msgSend)(sub, @selector(many)), 299);
+    testassertequal(((int(*)(id, SEL))objc_msgSend)(sub, sel_registerName("many100")), 100);
+    testassertequal(((int(*)(id, SEL))objc_msgSend)(base, sel_registerName("many299")), 299);
+    testassert([sub subValue] == 3);
+
+    RELEASE_VAR(base);
+    RELEASE_VAR(sub);
+    RELEASE_VAR(other);
+
+    succeed(__FILE__);
+}
@@ -0,0 +1,26 @@
+#include "test.h"
+
+@interface Base : TestRoot @end
+@interface Sub : Base @end
+@interface Other : TestRoot @end
+
+@implementation Base (One)
+-(int)value { return 1; }
+@end
+
+@implementation Sub (Three)
+-(int)subValue { return 3; }
+@end
+
+@implementation Base (Two)
+-(int)value { return 2; }
++(int)classValue { return 4; }
+@end
+
+@implementation Other (Six)
+-(int)value { return 6; }
+@end
+
+@implementation Base (Five)
+-(int)added { return 5; }
+@end
@@ -0,0 +1,28 @@
+// 200 categories on one class, for categoryBatch.m.
+// Each defines -many, so the last one loaded wins.
+
+#include "test.h"
+
+@interface Base : TestRoot @end
+
+#define CATEGORY(n)                                     \
+    @implementation Base (Many##n)                      \
+    -(int)many { return n; }                            \
+    -(int)many##n { return n; }                         \
+    @end
+
+#define CATEGORIES_10(t)                                \
+    CATEGORY(t##0) CATEGORY(t##1) CATEGORY(t##2)        \
+    CATEGORY(t##3) CATEGORY(t##4) CATEGORY(t##5)        \
+    CATEGORY(t##6) CATEGORY(t##7) CATEGORY(t##8)        \
+    CATEGORY(t##9)
+
+#define CATEGORIES_100(h)                               \
+    CATEGORIES_10(h##0) CATEGORIES_10(h##1)             \
+    CATEGORIES_10(h##2) CATEGORIES_10(h##3)             \
+    CATEGORIES_10(h##4) CATEGORIES_10(h##5)             \
+    CATEGORIES_10(h##6) CATEGORIES_10(h##7)             \
+    CATEGORIES_10(h##8) CATEGORIES_10(h##9)
+
+CATEGORIES_100(1)
+CATEGORIES_100(2)
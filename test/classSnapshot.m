@@ -0,0 +1,112 @@
+// TEST_CONFIG MEM=mrc
+
+// _objc_copyClassSnapshot() describes every realized class without
+// pointers, so it survives a round trip through a file.
+
+#include "test.h"
+#include "testroot.i"
+#include <objc/runtime.h>
+#include <objc/objc-internal.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+@protocol SnapshotProto @end
+
+@interface SnapshotSuper : TestRoot <SnapshotProto> {
+    id a;
+    long b;
+}
+@property id a;
+@end
+@implementation SnapshotSuper
+@synthesize a;
+-(void)one { }
+-(void)two { }
++(void)three { }
+@end
+
+@interface SnapshotSub : SnapshotSuper @end
+@implementation SnapshotSub
+-(void)four { }
+@end
+
+static const objc_class_snapshot_entry *
+find(const objc_class_snapshot *snapshot, Class cls)
+{
+    for (uint32_t i = 0; i < snapshot->classCount; i++) {
+        if (snapshot->classes[i].address == (uint64_t)(uintptr_t)cls) {
+            return &snapshot->classes[i];
+        }
+    }
+    return NULL;
+}
+
+static const char *
+nameOf(const objc_class_snapshot *snapshot, const objc_class_snapshot_entry *entry)
+{
+    return (const char *)snapshot + snapshot->stringsOffset + entry->nameOffset;
+}
+
+static void check(const objc_class_snapshot *snapshot)
+{
+    testassertequal(snapshot->magic, OBJC_CLASS_SNAPSHOT_MAGIC);
+    testassertequal(snapshot->version, OBJC_CLASS_SNAPSHOT_VERSION);
+    testassertequal(snapshot->entrySize, sizeof(objc_class_snapshot_entry));
+
+    const objc_class_snapshot_entry *sub = find(snapshot, [SnapshotSub class]);
+    const objc_class_snapshot_entry *sup = find(snapshot, [SnapshotSuper class]);
+    const objc_class_snapshot_entry *root = find(snapshot, [TestRoot class]);
+    testassert(sub  &&  sup  &&  root);
+
+    testassert(0 == strcmp(nameOf(snapshot, sub), "SnapshotSub"));
+    testassert(0 == strcmp(nameOf(snapshot, sup), "SnapshotSuper"));
+    testassert(&snapshot->classes[sub->superclassIndex] == sup);
+    testassert(&snapshot->classes[sup->superclassIndex] == root);
+    testassertequal(root->superclassIndex, OBJC_CLASS_SNAPSHOT_NO_SUPERCLASS);
+    testassert(sub->superclassIndex < (uint32_t)(sub - snapshot->classes));
+
+    testassertequal(sup->instanceSize, class_getInstanceSize([SnapshotSuper class]));
+    testassertequal(sup->ivarCount, 2);
+    testassertequal(sup->propertyCount, 1);
+    testassertequal(sup->protocolCount, 1);
+    testassertequal(sup->classMethodCount, 1);
+    unsigned count;
+    free(class_copyMethodList([SnapshotSuper class], &count));
+    testassertequal(sup->methodCount, count);
+    testassertequal(sub->methodCount, 1);
+    testassert(sup->flags & OBJC_CLASS_SNAPSHOT_INITIALIZED);
+    testassert(sup->cacheOccupied >= 1);
+    testassert(sup->cacheCapacity >= sup->cacheOccupied);
+}
+
+int main()
+{
+    id obj = [SnapshotSub new];
+    [obj one];
+    [obj release];
+    obj = [SnapshotSuper new];
+    [obj two];
+    [obj release];
+
+    objc_class_snapshot *snapshot = _objc_copyClassSnapshot();
+    testassert(snapshot);
+    check(snapshot);
+
+    char path[] = "/tmp/classSnapshot.XXXXXX";
+    int fd = mkstemp(path);
+    testassert(fd >= 0);
+    unlink(path);
+    testassertequal(write(fd, snapshot, snapshot->size), (ssize_t)snapshot->size);
+    void *mapped = mmap(NULL, snapshot->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    testassert(mapped != MAP_FAILED);
+    check((const objc_class_snapshot *)mapped);
+    testprintf("%u classes in %llu bytes\n", snapshot->classCount, snapshot->size);
+    munmap(mapped, snapshot->size);
+    close(fd);
+    free(snapshot);
+
+    succeed(__FILE__);
+}
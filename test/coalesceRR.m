@@ -0,0 +1,184 @@
+// TEST_ENV OBJC_COALESCE_RETAIN_RELEASE=YES
+// TEST_CONFIG MEM=mrc
+
+// With OBJC_COALESCE_RETAIN_RELEASE a release followed by a retain of
+// the same object on the same thread cancels out. A release is only
+// postponed when the object has other references. Postponed releases
+// are performed when the object is autoreleased or stored weakly, and
+// no later than the next autorelease pool push or pop.
+
+#include "test.h"
+#include <objc/NSObject.h>
+#include <objc/runtime.h>
+#include <objc/objc-internal.h>
+#include <pthread.h>
+#include <mach/mach_time.h>
+
+static int deallocs;
+
+@interface Counted : NSObject @end
+@implementation Counted
+-(void)dealloc { deallocs++; [super dealloc]; }
+@end
+
+@interface Holder : NSObject {
+@public
+    id value;
+}
+@end
+@implementation Holder @end
+
+#define ITERATIONS 1000
+#define BENCH_ITERATIONS 10000000
+
+static id shared;
+
+static void *releaseShared(void *arg __unused)
+{
+    [shared release];
+    return NULL;
+}
+
+static void *exitWithPending(void *arg __unused)
+{
+    objc_retain(shared);
+    objc_release(shared);
+    objc_release(shared);
+    return NULL;
+}
+
+int main()
+{
+    // ARC's sequence for reading a strong ivar into a local, repeated.
+    Holder *holder = [Holder new];
+    holder->value = [Counted new];
+    uint64_t before = objc_coalescedRetainReleaseCount();
+    for (int i = 0; i < ITERATIONS; i++) {
+        id local = objc_retain(holder->value);
+        testassertequal([local retainCount], 2);
+        objc_release(local);
+        testassertequal([holder->value retainCount], 1);
+    }
+    testassert(objc_coalescedRetainReleaseCount() - before >= ITERATIONS - 1);
+    testassertequal(deallocs, 0);
+
+    // The last release deallocates immediately.
+    objc_release(holder->value);
+    testassertequal(deallocs, 1);
+    holder->value = nil;
+
+    // Weak references.
+    id weak = nil;
+    id obj = [Counted new];
+    objc_storeWeak(&weak, obj);
+    objc_retain(obj);
+    objc_release(obj);
+    id loaded = objc_loadWeakRetained(&weak);
+    testassert(loaded == obj);
+    [loaded release];
+    objc_release(obj);
+    testassertequal(deallocs, 2);
+    testassert(objc_loadWeakRetained(&weak) == nil);
+
+    // Another thread releases the last reference while this thread
+    // still has a release parked. The object dies at the next pop.
+    void *pool = objc_autoreleasePoolPush();
+    obj = [Counted new];
+    objc_retain(obj);
+    objc_release(obj);
+    testassertequal([obj retainCount], 1);
+    shared = obj;
+    pthread_t th;
+    pthread_create(&th, NULL, &releaseShared, NULL);
+    pthread_join(th, NULL);
+    testassertequal(deallocs, 2);
+    objc_autoreleasePoolPop(pool);
+    testassertequal(deallocs, 3);
+
+    // More parked releases than the buffer holds.
+    id many[32];
+    for (int i = 0; i < 32; i++) {
+        many[i] = [Counted new];
+        objc_retain(many[i]);
+        objc_release(many[i]);
+    }
+    for (int i = 0; i < 32; i++) {
+        testassertequal([many[i] retainCount], 1);
+        objc_release(many[i]);
+    }
+    testassertequal(deallocs, 35);
+
+    // Parked releases are performed when their thread exits.
+    shared = [Counted new];
+    objc_retain(shared);
+    pthread_create(&th, NULL, &exitWithPending, NULL);
+    pthread_join(th, NULL);
+    testassertequal([shared retainCount], 1);
+    objc_release(shared);
+    testassertequal(deallocs, 36);
+
+    // Autoreleasing performs the parked release, so the following
+    // retain is not cancelled against it.
+    pool = objc_autoreleasePoolPush();
+    obj = [Counted new];
+    objc_retain(obj);
+    objc_retain(obj);
+    objc_release(obj);
+    before = objc_coalescedRetainReleaseCount();
+    objc_autorelease(obj);
+    objc_retain(obj);
+    testassertequal(objc_coalescedRetainReleaseCount(), before);
+    objc_release(obj);
+    objc_release(obj);
+    testassertequal(deallocs, 36);
+    objc_autoreleasePoolPop(pool);
+    testassertequal(deallocs, 37);
+
+    // So does storing a weak reference.
+    obj = [Counted new];
+    objc_retain(obj);
+    objc_release(obj);
+    before = objc_coalescedRetainReleaseCount();
+    objc_storeWeak(&weak, obj);
+    objc_retain(obj);
+    testassertequal(objc_coalescedRetainReleaseCount(), before);
+    testassertequal([obj retainCount], 2);
+    objc_release(obj);
+    objc_release(obj);
+    testassertequal(deallocs, 38);
+    testassert(objc_loadWeakRetained(&weak) == nil);
+
+    // A return value accepted without the handshake cancels
+    // against a parked release.
+    obj = [Counted new];
+    objc_retain(obj);
+    objc_release(obj);
+    before = objc_coalescedRetainReleaseCount();
+    testassert(objc_retainAutoreleasedReturnValue(obj) == obj);
+    testassertequal(objc_coalescedRetainReleaseCount(), before + 1);
+    objc_release(obj);
+    objc_release(obj);
+    testassertequal(deallocs, 39);
+
+    // Getter-style loop: release then retain of the same object.
+    obj = [Counted new];
+    objc_retain(obj);
+    before = objc_coalescedRetainReleaseCount();
+    uint64_t start = mach_absolute_time();
+    for (long i = 0; i < BENCH_ITERATIONS; i++) {
+        objc_release(obj);
+        objc_retain(obj);
+    }
+    uint64_t end = mach_absolute_time();
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    testprintf("release+retain: %.2f ns, %llu atomic updates avoided\n",
+               (double)(end - start) * tb.numer / tb.denom / BENCH_ITERATIONS,
+               2 * (objc_coalescedRetainReleaseCount() - before));
+    objc_release(obj);
+    objc_release(obj);
+    testassertequal(deallocs, 40);
+
+    [holder release];
+    succeed(__FILE__);
+}
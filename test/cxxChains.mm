@@ -0,0 +1,124 @@
+// TEST_CONFIG MEM=mrc
+
+// C++ ivar constructors and destructors are called from per-class
+// chains. They must run in the right order for single and batched
+// allocation, and replacing .cxx_construct must take effect.
+
+#include "test.h"
+#include <objc/NSObject.h>
+#include <objc/runtime.h>
+#include <mach/mach_time.h>
+
+static int ctorOrder[64], dtorOrder[64];
+static int ctorCount, dtorCount;
+
+template <int N>
+struct Member {
+    Member() { ctorOrder[ctorCount++] = N; }
+    ~Member() { dtorOrder[dtorCount++] = N; }
+};
+
+@interface Base : NSObject { Member<1> base; } @end
+@implementation Base @end
+
+@interface Middle : Base { int plain; } @end
+@implementation Middle @end
+
+@interface Sub : Middle { Member<2> sub; } @end
+@implementation Sub @end
+
+@interface Leaf : Sub { Member<3> leaf; } @end
+@implementation Leaf @end
+
+static void reset()
+{
+    ctorCount = dtorCount = 0;
+}
+
+static void checkCtors(int objects)
+{
+    testassertequal(ctorCount, 3 * objects);
+    for (int i = 0; i < objects; i++) {
+        testassertequal(ctorOrder[3*i + 0], 1);
+        testassertequal(ctorOrder[3*i + 1], 2);
+        testassertequal(ctorOrder[3*i + 2], 3);
+    }
+}
+
+static void checkDtors()
+{
+    testassertequal(dtorCount, 3);
+    testassertequal(dtorOrder[0], 3);
+    testassertequal(dtorOrder[1], 2);
+    testassertequal(dtorOrder[2], 1);
+}
+
+static void checkOrder()
+{
+    checkCtors(1);
+    checkDtors();
+}
+
+static int replacedCtors;
+static IMP originalCtor;
+static id replacementCtor(id self, SEL _cmd)
+{
+    replacedCtors++;
+    return ((id(*)(id, SEL))originalCtor)(self, _cmd);
+}
+
+#define BATCH 16
+#define BENCH_ITERATIONS 1000000
+
+int main()
+{
+    reset();
+    [[Leaf new] release];
+    checkOrder();
+
+    // class_createInstance.
+    reset();
+    id obj = class_createInstance([Leaf class], 0);
+    testassertequal(ctorCount, 3);
+    [obj release];
+    checkOrder();
+
+    // Batched allocation.
+    id objs[BATCH];
+    reset();
+    unsigned n = class_createInstances([Leaf class], 0, objs, BATCH);
+    testassertequal(n, BATCH);
+    checkCtors(BATCH);
+    for (unsigned i = 0; i < n; i++) {
+        reset();
+        [objs[i] release];
+        checkDtors();
+    }
+
+    // Replacing .cxx_construct takes effect for later allocations.
+    Method m = class_getInstanceMethod([Sub class], sel_registerName(".cxx_construct"));
+    testassert(m);
+    originalCtor = method_setImplementation(m, (IMP)replacementCtor);
+    reset();
+    [[Leaf new] release];
+    testassertequal(replacedCtors, 1);
+    checkOrder();
+    method_setImplementation(m, originalCtor);
+    reset();
+    [[Leaf new] release];
+    testassertequal(replacedCtors, 1);
+    checkOrder();
+
+    uint64_t start = mach_absolute_time();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        reset();
+        [[Leaf new] release];
+    }
+    uint64_t end = mach_absolute_time();
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    testprintf("alloc+dealloc with 3 C++ ivar classes: %.1f ns\n",
+               (double)(end - start) * tb.numer / tb.denom / BENCH_ITERATIONS);
+
+    succeed(__FILE__);
+}
@@ -0,0 +1,75 @@
+// TEST_CONFIG MEM=mrc
+
+// Disposing a class frees its C++ ivar constructor and destructor
+// chains. A new class allocated at the same address must run its own
+// chains for single and batched allocation, and churning through many
+// dynamic subclasses must not use up the chain table.
+
+#include "test.h"
+#include <objc/NSObject.h>
+#include <objc/runtime.h>
+
+static int ctorCount[3], dtorCount[3];
+
+template <int N>
+struct Member {
+    Member() { ctorCount[N]++; }
+    ~Member() { dtorCount[N]++; }
+};
+
+@interface Base : NSObject { Member<0> base; } @end
+@implementation Base @end
+
+@interface Deep : Base { Member<1> middle; Member<2> deep; } @end
+@implementation Deep @end
+
+#define CLASSES 5000
+#define BATCH 4
+
+static void reset()
+{
+    for (int i = 0; i < 3; i++) ctorCount[i] = dtorCount[i] = 0;
+}
+
+int main()
+{
+    unsigned reused = 0;
+    Class previous = Nil;
+
+    for (int i = 0; i < CLASSES; i++) {
+        // Alternate superclasses, so that a stale chain left at a
+        // reused address would run the wrong constructors.
+        bool deep = i % 2 == 0;
+        Class cls = objc_allocateClassPair(deep ? [Deep class] : [Base class],
+                                           "Dynamic", 0);
+        testassert(cls);
+        objc_registerClassPair(cls);
+        if (cls == previous) reused++;
+
+        reset();
+        [[cls new] release];
+        testassertequal(ctorCount[0], 1);
+        testassertequal(dtorCount[0], 1);
+        testassertequal(ctorCount[1], deep ? 1 : 0);
+        testassertequal(dtorCount[1], deep ? 1 : 0);
+        testassertequal(ctorCount[2], deep ? 1 : 0);
+        testassertequal(dtorCount[2], deep ? 1 : 0);
+
+        id objs[BATCH];
+        reset();
+        testassertequal(class_createInstances(cls, 0, objs, BATCH), BATCH);
+        testassertequal(ctorCount[0], BATCH);
+        testassertequal(ctorCount[2], deep ? BATCH : 0);
+        for (int j = 0; j < BATCH; j++) [objs[j] release];
+        testassertequal(dtorCount[0], BATCH);
+        testassertequal(dtorCount[2], deep ? BATCH : 0);
+
+        objc_disposeClassPair(cls);
+        previous = cls;
+    }
+
+    testprintf("%u of %d classes reused the previous address\n",
+               reused, CLASSES);
+
+    succeed(__FILE__);
+}
@@ -0,0 +1,114 @@
+// TEST_CONFIG MEM=mrc
+
+// Objects whose only deallocation work is C++ destructors skip
+// objc_destructInstance(). Destructors must still run most-derived
+// class first, associations added by a destructor must still be
+// removed, and changing a .cxx_destruct method must take effect.
+
+#include "test.h"
+#include <objc/NSObject.h>
+#include <objc/runtime.h>
+#include <mach/mach_time.h>
+
+static int order[8];
+static int orderCount;
+static int deallocs;
+static char key;
+
+@interface Counted : NSObject @end
+@implementation Counted
+-(void)dealloc { deallocs++; [super dealloc]; }
+@end
+
+struct BaseMember {
+    ~BaseMember() { order[orderCount++] = 1; }
+};
+
+struct SubMember {
+    id owner = nil;
+    ~SubMember() {
+        order[orderCount++] = 2;
+        if (owner) {
+            id value = [Counted new];
+            objc_setAssociatedObject(owner, &key, value, OBJC_ASSOCIATION_RETAIN);
+            [value release];
+        }
+    }
+};
+
+@interface Base : NSObject {
+@public
+    BaseMember base;
+}
+@end
+@implementation Base @end
+
+@interface Middle : Base { int plain; } @end
+@implementation Middle @end
+
+@interface Sub : Middle {
+@public
+    SubMember sub;
+}
+@end
+@implementation Sub @end
+
+static int replacedDtors;
+static IMP originalDtor;
+static void replacementDtor(id self, SEL _cmd)
+{
+    replacedDtors++;
+    ((void(*)(id, SEL))originalDtor)(self, _cmd);
+}
+
+#define BENCH_ITERATIONS 1000000
+
+int main()
+{
+    // Destructors run most-derived first.
+    orderCount = 0;
+    [[Sub new] release];
+    testassertequal(orderCount, 2);
+    testassertequal(order[0], 2);
+    testassertequal(order[1], 1);
+
+    // A destructor associates an object with the dying object.
+    Sub *sub = [Sub new];
+    sub->sub.owner = sub;
+    orderCount = 0;
+    [sub release];
+    testassertequal(orderCount, 2);
+    testassertequal(deallocs, 1);
+
+    // Weak references still take the full path.
+    id weak = nil;
+    sub = [Sub new];
+    objc_storeWeak(&weak, sub);
+    [sub release];
+    testassert(objc_loadWeakRetained(&weak) == nil);
+
+    // Replacing .cxx_destruct takes effect for later deallocations.
+    Method m = class_getInstanceMethod([Sub class], sel_registerName(".cxx_destruct"));
+    testassert(m);
+    originalDtor = method_setImplementation(m, (IMP)replacementDtor);
+    orderCount = 0;
+    [[Sub new] release];
+    testassertequal(replacedDtors, 1);
+    testassertequal(orderCount, 2);
+    method_setImplementation(m, originalDtor);
+    [[Sub new] release];
+    testassertequal(replacedDtors, 1);
+
+    uint64_t start = mach_absolute_time();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        orderCount = 0;
+        [[Sub new] release];
+    }
+    uint64_t end = mach_absolute_time();
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    testprintf("alloc+dealloc with C++ ivars: %.1f ns\n",
+               (double)(end - start) * tb.numer / tb.denom / BENCH_ITERATIONS);
+
+    succeed(__FILE__);
+}
@@ -0,0 +1,205 @@
+// TEST_ENV OBJC_DEFERRED_RC=YES
+// TEST_CONFIG MEM=mrc
+
+// With OBJC_DEFERRED_RC the allocating thread counts its own retains
+// and releases without atomics. Retain counts, weak references and
+// deallocation must behave as usual, including when other threads
+// release references that the allocating thread handed to them, or
+// change the object's isa to a raw pointer.
+
+#include "test.h"
+#include <objc/NSObject.h>
+#include <objc/runtime.h>
+#include <objc/objc-internal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <mach/mach_time.h>
+
+static atomic_int deallocs;
+
+@interface Counted : NSObject @end
+@implementation Counted
+-(void)dealloc { atomic_fetch_add(&deallocs, 1); [super dealloc]; }
+@end
+
+// More than half of the inline retain count on every architecture.
+#define LOTS (1 << 19)
+#define THREADS 4
+#define ITERATIONS 100000
+#define BENCH_ITERATIONS 10000000
+
+static id shared;
+static long sharedReleases;
+
+static void *releaseShared(void *arg __unused)
+{
+    for (long i = 0; i < sharedReleases; i++) [shared release];
+    return NULL;
+}
+
+static void *retainReleaseShared(void *arg __unused)
+{
+    for (long i = 0; i < ITERATIONS; i++) {
+        [shared retain];
+        [shared release];
+    }
+    return NULL;
+}
+
+static void *allocShared(void *arg __unused)
+{
+    shared = [Counted new];
+    return NULL;
+}
+
+// Instances of a future class have a raw isa.
+static void *swizzleAndReleaseShared(void *arg __unused)
+{
+    object_setClass(shared, objc_getFutureClass("DeferredRCFuture"));
+    object_setClass(shared, [Counted class]);
+    return releaseShared(arg);
+}
+
+static void swizzleAndReleaseOnThread(id obj, long count)
+{
+    pthread_t th;
+    shared = obj;
+    sharedReleases = count;
+    pthread_create(&th, NULL, &swizzleAndReleaseShared, NULL);
+    pthread_join(th, NULL);
+}
+
+static void releaseOnThread(id obj, long count)
+{
+    pthread_t th;
+    shared = obj;
+    sharedReleases = count;
+    pthread_create(&th, NULL, &releaseShared, NULL);
+    pthread_join(th, NULL);
+}
+
+static double nsPerIteration(uint64_t start, uint64_t end)
+{
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    return (double)(end - start) * tb.numer / tb.denom / BENCH_ITERATIONS;
+}
+
+int main()
+{
+    // Owner-only retains and releases.
+    id obj = [Counted new];
+    testassertequal([obj retainCount], 1);
+    [obj retain];
+    [obj retain];
+    [obj retain];
+    testassertequal([obj retainCount], 4);
+    [obj release];
+    [obj release];
+    [obj release];
+    testassertequal([obj retainCount], 1);
+    [obj release];
+    testassertequal(deallocs, 1);
+
+    // Weak references.
+    id weak = nil;
+    obj = [Counted new];
+    objc_storeWeak(&weak, obj);
+    id loaded = objc_loadWeakRetained(&weak);
+    testassert(loaded == obj);
+    [loaded release];
+    [obj release];
+    testassertequal(deallocs, 2);
+    testassert(objc_loadWeak(&weak) == nil);
+
+    // Another thread releases the owner's only reference.
+    // The object dies no later than the owner's next pool pop.
+    void *pool = objc_autoreleasePoolPush();
+    obj = [Counted new];
+    releaseOnThread(obj, 1);
+    objc_autoreleasePoolPop(pool);
+    testassertequal(deallocs, 3);
+
+    // Another thread releases more of the owner's references than
+    // the inline count can absorb.
+    pool = objc_autoreleasePoolPush();
+    obj = [Counted new];
+    for (long i = 0; i < LOTS; i++) [obj retain];
+    testassertequal([obj retainCount], LOTS + 1);
+    releaseOnThread(obj, LOTS);
+    testassertequal([obj retainCount], 1);
+    testassertequal(deallocs, 3);
+    releaseOnThread(obj, 1);
+    objc_autoreleasePoolPop(pool);
+    testassertequal(deallocs, 4);
+
+    // Other threads retain and release while the owner does too.
+    obj = [Counted new];
+    shared = obj;
+    pthread_t threads[THREADS];
+    for (int t = 0; t < THREADS; t++) {
+        pthread_create(&threads[t], NULL, &retainReleaseShared, NULL);
+    }
+    for (long i = 0; i < ITERATIONS; i++) {
+        [obj retain];
+        [obj release];
+    }
+    for (int t = 0; t < THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    testassertequal([obj retainCount], 1);
+    [obj release];
+    testassertequal(deallocs, 5);
+
+    // The owner exits while another thread holds its reference.
+    pthread_t th;
+    pthread_create(&th, NULL, &allocShared, NULL);
+    pthread_join(th, NULL);
+    testassertequal([shared retainCount], 1);
+    [shared release];
+    testassertequal(deallocs, 6);
+
+    // Another thread gives the object a raw isa while the owner
+    // still holds deferred references, then releases one of them.
+    pool = objc_autoreleasePoolPush();
+    obj = [Counted new];
+    [obj retain];
+    [obj retain];
+    swizzleAndReleaseOnThread(obj, 1);
+    [obj release];
+    objc_autoreleasePoolPop(pool);
+    testassertequal(deallocs, 6);
+    testassertequal([obj retainCount], 1);
+    [obj release];
+    testassertequal(deallocs, 7);
+
+    // As above, releasing more than the side table count can absorb.
+    pool = objc_autoreleasePoolPush();
+    obj = [Counted new];
+    for (long i = 0; i < LOTS; i++) [obj retain];
+    swizzleAndReleaseOnThread(obj, LOTS + 1);
+    testassertequal(deallocs, 7);
+    objc_autoreleasePoolPop(pool);
+    testassertequal(deallocs, 8);
+
+    // Single-threaded retain/release loop, owned object versus one
+    // created without the default +alloc and so never deferred.
+    obj = [Counted new];
+    id plain = class_createInstance([Counted class], 0);
+    uint64_t start = mach_absolute_time();
+    for (long i = 0; i < BENCH_ITERATIONS; i++) {
+        objc_release(objc_retain(obj));
+    }
+    uint64_t mid = mach_absolute_time();
+    for (long i = 0; i < BENCH_ITERATIONS; i++) {
+        objc_release(objc_retain(plain));
+    }
+    uint64_t end = mach_absolute_time();
+    testprintf("retain+release: %.2f ns deferred, %.2f ns atomic\n",
+               nsPerIteration(start, mid), nsPerIteration(mid, end));
+    [obj release];
+    [plain release];
+    testassertequal(deallocs, 10);
+
+    succeed(__FILE__);
+}
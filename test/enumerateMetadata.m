@@ -0,0 +1,186 @@
+// TEST_CONFIG MEM=mrc
+
+// The _class_enumerate* and _objc_enumerateClasses() functions visit
+// the same entries as the copy*List() functions, may call back into
+// the runtime, and stop when the callback returns false. The callback
+// of _objc_enumerateClasses() may dispose the classes it visits.
+
+#include "test.h"
+#include "testroot.i"
+#include <objc/runtime.h>
+#include <objc/objc-internal.h>
+#include <mach/mach_time.h>
+
+@protocol P1 @end
+@protocol P2 @end
+
+@interface Many : TestRoot <P1, P2> {
+    id ivar1;
+    int ivar2;
+}
+@property int prop1;
+@property id prop2;
+@end
+
+@implementation Many
+@synthesize prop1 = ivar2;
+@synthesize prop2 = ivar1;
+@end
+
+@interface Many (Category)
+-(void)categoryMethod;
+@end
+@implementation Many (Category)
+-(void)categoryMethod { }
+@end
+
+// More than one batch of methods.
+#define METHODS 200
+#define BENCH_ITERATIONS 10000
+
+typedef struct {
+    void **items;
+    unsigned count;
+    unsigned stopAfter;
+} collector;
+
+static bool collect(void *item, void *context)
+{
+    collector *c = (collector *)context;
+    c->items[c->count++] = item;
+    return c->count != c->stopAfter;
+}
+
+static void checkSame(void **items, unsigned count, void **copied, unsigned copiedCount)
+{
+    testassertequal(count, copiedCount);
+    for (unsigned i = 0; i < count; i++) {
+        testassert(items[i] == copied[i]);
+    }
+}
+
+static void noop(void) { }
+
+static bool addsMethods(Method m, void *context)
+{
+    // Calls back into the runtime, and attaches a new method list.
+    unsigned *count = (unsigned *)context;
+    testassert(class_getInstanceMethod([Many class], method_getName(m)));
+    char name[32];
+    snprintf(name, sizeof(name), "added%u", (*count)++);
+    class_addMethod([Many class], sel_registerName(name), (IMP)noop, "v@:");
+    return true;
+}
+
+static bool countAll(void *item __unused, void *context)
+{
+    (*(unsigned *)context)++;
+    return true;
+}
+
+#define DYNAMIC_CLASSES 300
+
+static bool disposeDynamic(Class cls, void *context)
+{
+    if (0 == strncmp(class_getName(cls), "Dynamic_", 8)) {
+        objc_disposeClassPair(cls);
+        (*(unsigned *)context)++;
+    }
+    return true;
+}
+
+int main()
+{
+    Class cls = [Many class];
+    for (int i = 0; i < METHODS; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "method%d", i);
+        class_addMethod(cls, sel_registerName(name), (IMP)noop, "v@:");
+    }
+
+    void *items[1024];
+    unsigned count;
+    collector c;
+
+    Method *methods = class_copyMethodList(cls, &count);
+    c = (collector){ items, 0, 0 };
+    testassertequal(_class_enumerateMethods(cls, (bool(*)(Method, void *))collect, &c), count);
+    checkSame(items, c.count, (void **)methods, count);
+    testassert(count > METHODS);
+
+    c = (collector){ items, 0, 100 };
+    testassertequal(_class_enumerateMethods(cls, (bool(*)(Method, void *))collect, &c), 100);
+    free(methods);
+
+    Ivar *ivars = class_copyIvarList(cls, &count);
+    c = (collector){ items, 0, 0 };
+    testassertequal(_class_enumerateIvars(cls, (bool(*)(Ivar, void *))collect, &c), 2);
+    checkSame(items, c.count, (void **)ivars, count);
+    free(ivars);
+
+    objc_property_t *props = class_copyPropertyList(cls, &count);
+    c = (collector){ items, 0, 0 };
+    testassertequal(_class_enumerateProperties(cls, (bool(*)(objc_property_t, void *))collect, &c), 2);
+    checkSame(items, c.count, (void **)props, count);
+    free(props);
+
+    Protocol * __unsafe_unretained *protos = class_copyProtocolList(cls, &count);
+    c = (collector){ items, 0, 0 };
+    testassertequal(_class_enumerateProtocols(cls, (bool(*)(Protocol *, void *))collect, &c), 2);
+    checkSame(items, c.count, (void **)protos, count);
+    free(protos);
+
+    testassertequal(_class_enumerateMethods(Nil, (bool(*)(Method, void *))collect, &c), 0);
+
+    // Methods added during enumeration attach new lists in front.
+    // Every original method is still visited exactly once.
+    unsigned before = 0;
+    _class_enumerateMethods(cls, (bool(*)(Method, void *))countAll, &before);
+    unsigned added = 0;
+    testassertequal(_class_enumerateMethods(cls, addsMethods, &added), before);
+
+    Class *classes = objc_copyClassList(&count);
+    unsigned enumerated = 0;
+    testassertequal(_objc_enumerateClasses((bool(*)(Class, void *))countAll, &enumerated), count);
+    testassertequal(enumerated, count);
+    bool found = false;
+    for (unsigned i = 0; i < count; i++) {
+        if (classes[i] == cls) found = true;
+        testassert(!class_isMetaClass(classes[i]));
+    }
+    testassert(found);
+    free(classes);
+
+    // Disposing classes during enumeration, including the last class
+    // of a batch, must not disturb the walk.
+    for (int i = 0; i < DYNAMIC_CLASSES; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "Dynamic_%d", i);
+        objc_registerClassPair(objc_allocateClassPair([TestRoot class], name, 0));
+    }
+    unsigned disposed = 0;
+    _objc_enumerateClasses(disposeDynamic, &disposed);
+    testassertequal(disposed, DYNAMIC_CLASSES);
+    testassert(objc_getClass("Dynamic_0") == nil);
+    free(objc_copyClassList(&count));
+    testassertequal(count, enumerated);
+
+    uint64_t start = mach_absolute_time();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        free(class_copyMethodList(cls, &count));
+    }
+    uint64_t mid = mach_absolute_time();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        unsigned n = 0;
+        _class_enumerateMethods(cls, (bool(*)(Method, void *))countAll, &n);
+    }
+    uint64_t end = mach_absolute_time();
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    testprintf("%u methods: class_copyMethodList %.1f ns, "
+               "_class_enumerateMethods %.1f ns\n", count,
+               (double)(mid - start) * tb.numer / tb.denom / BENCH_ITERATIONS,
+               (double)(end - mid) * tb.numer / tb.denom / BENCH_ITERATIONS);
+
+    succeed(__FILE__);
+}
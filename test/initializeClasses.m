@@ -0,0 +1,114 @@
+// TEST_CONFIG MEM=mrc
+
+// objc_initializeClasses() sends +initialize to classes and their
+// superclasses ahead of time, initializing independent hierarchies on
+// several threads. objc_initializeClassesForImage() does the same for
+// every class in an image.
+
+#include "test.h"
+#include "testroot.i"
+#include <objc/runtime.h>
+#include <objc/objc-internal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <mach/mach_time.h>
+
+#define HIERARCHIES 32
+#define DEPTH 3
+
+static Class classes[HIERARCHIES][DEPTH];
+static atomic_int initializeCounts[HIERARCHIES][DEPTH];
+static pthread_t initializeThreads[HIERARCHIES][DEPTH];
+
+static void initializeImp(Class self, SEL _cmd __unused)
+{
+    for (int h = 0; h < HIERARCHIES; h++) {
+        for (int d = 0; d < DEPTH; d++) {
+            if (classes[h][d] != self) continue;
+            for (int s = 0; s < d; s++) {
+                testassertequal(atomic_load(&initializeCounts[h][s]), 1);
+            }
+            atomic_fetch_add(&initializeCounts[h][d], 1);
+            initializeThreads[h][d] = pthread_self();
+            usleep(1000);
+            return;
+        }
+    }
+}
+
+static int staticInitializes;
+
+@interface StaticSuper : TestRoot @end
+@implementation StaticSuper
++(void)initialize { if (self == [StaticSuper class]) staticInitializes++; }
+@end
+
+@interface StaticSub : StaticSuper @end
+@implementation StaticSub
++(void)initialize { staticInitializes++; }
+@end
+
+int main()
+{
+    for (int h = 0; h < HIERARCHIES; h++) {
+        Class superclass = [TestRoot class];
+        for (int d = 0; d < DEPTH; d++) {
+            char *name;
+            asprintf(&name, "InitClasses_%d_%d", h, d);
+            Class cls = objc_allocateClassPair(superclass, name, 0);
+            free(name);
+            class_addMethod(object_getClass(cls), @selector(initialize),
+                            (IMP)initializeImp, "v@:");
+            objc_registerClassPair(cls);
+            classes[h][d] = cls;
+            superclass = cls;
+        }
+    }
+
+    // Only the leaves, plus entries that must be ignored.
+    Class list[HIERARCHIES + 3];
+    unsigned count = 0;
+    for (int h = 0; h < HIERARCHIES; h++) list[count++] = classes[h][DEPTH-1];
+    list[count++] = Nil;
+    list[count++] = object_getClass(classes[0][0]);
+    list[count++] = classes[0][DEPTH-1];
+
+    uint64_t start = mach_absolute_time();
+    objc_initializeClasses(list, count);
+    uint64_t end = mach_absolute_time();
+
+    int threads = 0;
+    pthread_t seen[HIERARCHIES * DEPTH];
+    for (int h = 0; h < HIERARCHIES; h++) {
+        for (int d = 0; d < DEPTH; d++) {
+            testassertequal(atomic_load(&initializeCounts[h][d]), 1);
+            int i;
+            for (i = 0; i < threads; i++) {
+                if (pthread_equal(seen[i], initializeThreads[h][d])) break;
+            }
+            if (i == threads) seen[threads++] = initializeThreads[h][d];
+        }
+    }
+
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    testprintf("%d classes on %d threads: %.2f ms (%.2f ms serially)\n",
+               HIERARCHIES * DEPTH, threads,
+               (double)(end - start) * tb.numer / tb.denom / 1000000.0,
+               HIERARCHIES * DEPTH * 1.0);
+
+    // Initialized classes are skipped.
+    objc_initializeClasses(list, count);
+    for (int h = 0; h < HIERARCHIES; h++) {
+        testassertequal(atomic_load(&initializeCounts[h][DEPTH-1]), 1);
+    }
+
+    Dl_info info;
+    testassert(dladdr((void *)&main, &info));
+    objc_initializeClassesForImage(info.dli_fname);
+    testassertequal(staticInitializes, 2);
+
+    succeed(__FILE__);
+}
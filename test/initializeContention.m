@@ -0,0 +1,91 @@
+// TEST_CONFIG MEM=mrc
+
+// Many threads touch many independent class hierarchies at once.
+// Every +initialize must run exactly once, superclasses first, and
+// threads that find a class being initialized by another thread must
+// wake up when it finishes.
+
+#include "test.h"
+#include "testroot.i"
+#include <objc/runtime.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <mach/mach_time.h>
+
+#define HIERARCHIES 64
+#define DEPTH 3
+#define THREADS 16
+
+static Class classes[HIERARCHIES][DEPTH];
+static atomic_int initializeCounts[HIERARCHIES][DEPTH];
+
+static void initializeImp(Class self, SEL _cmd __unused)
+{
+    for (int h = 0; h < HIERARCHIES; h++) {
+        for (int d = 0; d < DEPTH; d++) {
+            if (classes[h][d] != self) continue;
+            // Superclasses finish first.
+            for (int s = 0; s < d; s++) {
+                testassertequal(atomic_load(&initializeCounts[h][s]), 1);
+            }
+            atomic_fetch_add(&initializeCounts[h][d], 1);
+            // Long enough for other threads to block on this class.
+            usleep(200);
+            return;
+        }
+    }
+}
+
+static void *touchAll(void *arg)
+{
+    // Each thread starts at a different hierarchy.
+    uintptr_t start = (uintptr_t)arg;
+    for (int i = 0; i < HIERARCHIES; i++) {
+        int h = (int)((start + i) % HIERARCHIES);
+        [classes[h][DEPTH-1] class];  // sends +initialize
+    }
+    return NULL;
+}
+
+int main()
+{
+    for (int h = 0; h < HIERARCHIES; h++) {
+        Class superclass = [TestRoot class];
+        for (int d = 0; d < DEPTH; d++) {
+            char *name;
+            asprintf(&name, "InitContention_%d_%d", h, d);
+            Class cls = objc_allocateClassPair(superclass, name, 0);
+            free(name);
+            class_addMethod(object_getClass(cls), @selector(initialize),
+                            (IMP)initializeImp, "v@:");
+            objc_registerClassPair(cls);
+            classes[h][d] = cls;
+            superclass = cls;
+        }
+    }
+
+    pthread_t threads[THREADS];
+    uint64_t begin = mach_absolute_time();
+    for (uintptr_t t = 0; t < THREADS; t++) {
+        pthread_create(&threads[t], NULL, &touchAll,
+                       (void *)(t * HIERARCHIES / THREADS));
+    }
+    for (int t = 0; t < THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    uint64_t end = mach_absolute_time();
+
+    for (int h = 0; h < HIERARCHIES; h++) {
+        for (int d = 0; d < DEPTH; d++) {
+            testassertequal(atomic_load(&initializeCounts[h][d]), 1);
+        }
+    }
+
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    testprintf("%d threads, %d hierarchies: %.2f ms\n", THREADS, HIERARCHIES,
+               (double)(end - begin) * tb.numer / tb.denom / 1000000.0);
+
+    succeed(__FILE__);
+}
@@ -0,0 +1,63 @@
+// TEST_CFLAGS -Wl,-no_objc_category_merging
+
+#include "test.h"
+#include "testroot.i"
+#include <objc/runtime.h>
+
+// Enough categories to push Indexed past method_index_t::minLists.
+// Each category overrides -value; the last one loaded must win.
+
+@interface Indexed : TestRoot
+-(int)base;
+@end
+@interface Indexed (Overridden)
+-(int)value;
+@end
+@implementation Indexed
+-(int)value { fail("-value not overridden by category"); return -1; }
+-(int)base { return 100; }
+@end
+
+#define CATEGORY(n)                                     \
+    @interface Indexed (Cat##n)                         \
+    -(int)cat##n;                                       \
+    @end                                                \
+    @implementation Indexed (Cat##n)                    \
+    -(int)value { return n; }                           \
+    -(int)cat##n { return n; }                          \
+    @end
+
+CATEGORY(0)  CATEGORY(1)  CATEGORY(2)  CATEGORY(3)
+CATEGORY(4)  CATEGORY(5)  CATEGORY(6)  CATEGORY(7)
+CATEGORY(8)  CATEGORY(9)  CATEGORY(10) CATEGORY(11)
+
+static int added(id self __unused, SEL _cmd __unused) { return 200; }
+static int replaced(id self __unused, SEL _cmd __unused) { return 300; }
+
+int main()
+{
+    Indexed *obj = [Indexed new];
+
+    testassert([obj value] == 11);
+    testassert([obj base] == 100);
+    testassert([obj cat0] == 0);
+    testassert([obj cat7] == 7);
+    testassert([obj cat11] == 11);
+    testassert(![obj respondsToSelector:@selector(missing)]);
+
+    // Adding a method must invalidate the index built above.
+    SEL sel = sel_registerName("addedAfterIndex");
+    testassert(!class_getInstanceMethod([Indexed class], sel));
+    testassert(class_addMethod([Indexed class], sel, (IMP)added, "i@:"));
+    testassert(((int(*)(id, SEL))objc_msgSend)(obj, sel) == 200);
+    testassert(class_getInstanceMethod([Indexed class], sel));
+
+    // Replacing an existing method finds the winning category method.
+    class_replaceMethod([Indexed class], @selector(value), (IMP)replaced, "i@:");
+    testassert([obj value] == 300);
+    testassert([obj cat11] == 11);
+
+    RELEASE_VAR(obj);
+
+    succeed(__FILE__);
+}
@@ -0,0 +1,76 @@
+// TEST_CONFIG
+
+// Correctness and timing of method list searches across the list sizes
+// seen in practice. Most lists are short and take the linear scan;
+// the longer ones take the branchless binary search.
+
+#include "test.h"
+#include <objc/runtime.h>
+#include <objc/objc-internal.h>
+#include <mach/mach_time.h>
+
+#define LOOKUPS 20000
+
+static const uint32_t sizes[] = { 1, 2, 3, 5, 8, 12, 16, 17, 24, 40, 64, 150, 500 };
+
+static id fn(id self, SEL _cmd __unused) { return self; }
+
+int main()
+{
+    Class root = objc_allocateClassPair(NULL, "MLSRoot", 0);
+    objc_registerClassPair(root);
+
+    for (size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++) {
+        uint32_t count = sizes[s];
+
+        char *name;
+        asprintf(&name, "MLSClass_%u", count);
+        Class cls = objc_allocateClassPair(root, name, 0);
+        objc_registerClassPair(cls);
+        free(name);
+
+        // Register twice as many selectors as methods so that
+        // every other one is a miss in the middle of the list.
+        SEL *sels = (SEL *)malloc(2 * count * sizeof(SEL));
+        SEL *names = (SEL *)malloc(count * sizeof(SEL));
+        IMP *imps = (IMP *)malloc(count * sizeof(IMP));
+        const char **types = (const char **)malloc(count * sizeof(char *));
+        for (uint32_t i = 0; i < 2 * count; i++) {
+            char *selname;
+            asprintf(&selname, "mls_%u_%u", count, i);
+            sels[i] = sel_registerName(selname);
+            free(selname);
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            names[i] = sels[2 * i];
+            imps[i] = (IMP)fn;
+            types[i] = "@@:";
+        }
+        SEL *failed = class_addMethodsBulk(cls, names, imps, types, count, NULL);
+        testassert(!failed);
+
+        for (uint32_t i = 0; i < 2 * count; i++) {
+            Method m = class_getInstanceMethod(cls, sels[i]);
+            if (i % 2 == 0) {
+                testassert(m);
+                testassert(method_getName(m) == sels[i]);
+            } else {
+                testassert(!m);
+            }
+        }
+
+        uint64_t startTime = mach_absolute_time();
+        for (uint32_t i = 0; i < LOOKUPS; i++) {
+            (void)class_getInstanceMethod(cls, sels[i % (2 * count)]);
+        }
+        uint64_t totalTime = mach_absolute_time() - startTime;
+        testprintf("time: %u methods  %llu\n", count, totalTime);
+
+        free(sels);
+        free(names);
+        free(imps);
+        free(types);
+    }
+
+    succeed(__FILE__);
+}
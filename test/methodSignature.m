@@ -0,0 +1,98 @@
+// TEST_CONFIG MEM=mrc
+
+// _objc_getMethodSignature() parses a method type string once and
+// returns the same interned signature for equal strings. The method_*
+// argument accessors are built on it and must agree with it.
+
+#include "test.h"
+#include "testroot.i"
+#include <objc/runtime.h>
+#include <objc/objc-internal.h>
+#include <string.h>
+#include <mach/mach_time.h>
+
+@interface Sig : TestRoot @end
+@implementation Sig
+-(id)objectAtIndex:(unsigned long)i withRect:(struct { double x, y; })r { (void)i; (void)r; return self; }
+@end
+
+#define BENCH_ITERATIONS 1000000
+
+int main()
+{
+    testassert(_objc_getMethodSignature(NULL) == NULL);
+
+    const objc_method_signature *sig =
+        _objc_getMethodSignature("r^{Foo=ii}32@0:8r*16i-8i24");
+    testassert(sig);
+    testassertequal(sig->argumentCount, 5);
+    testassertequal(sig->frameSize, 32);
+    testassert(0 == strcmp(sig->returnType, "r^{Foo=ii}"));
+    testassertequal(sig->returnCode, '^');
+    testassert(0 == strcmp(sig->arguments[0].type, "@"));
+    testassertequal(sig->arguments[0].code, '@');
+    testassertequal(sig->arguments[0].offset, 0);
+    testassert(0 == strcmp(sig->arguments[1].type, ":"));
+    testassertequal(sig->arguments[1].offset, 8);
+    testassert(0 == strcmp(sig->arguments[2].type, "r*"));
+    testassertequal(sig->arguments[2].code, '*');
+    testassertequal(sig->arguments[2].offset, 16);
+    testassertequal(sig->arguments[3].offset, -8);
+    testassert(0 == strcmp(sig->arguments[4].type, "i"));
+    testassertequal(sig->arguments[4].position, 23);
+
+    // Equal strings at different addresses share one signature.
+    char *copy = strdup("v24@0:8@16");
+    const objc_method_signature *a = _objc_getMethodSignature("v24@0:8@16");
+    const objc_method_signature *b = _objc_getMethodSignature(copy);
+    testassert(a == b);
+    testassert(a->types != copy);
+
+    // A different string at the same address gets its own signature.
+    strcpy(copy, "q16@0:8");
+    const objc_method_signature *c = _objc_getMethodSignature(copy);
+    testassert(c != a);
+    testassertequal(c->argumentCount, 2);
+    testassertequal(c->returnCode, 'q');
+    free(copy);
+
+    // The method_* accessors agree with the signature.
+    Method m = class_getInstanceMethod([Sig class],
+                                       @selector(objectAtIndex:withRect:));
+    testassert(m);
+    sig = _objc_getMethodSignature(method_getTypeEncoding(m));
+    unsigned count = method_getNumberOfArguments(m);
+    testassertequal(count, 4);
+    testassertequal(sig->argumentCount, count);
+    for (unsigned i = 0; i < count; i++) {
+        char *type = method_copyArgumentType(m, i);
+        testassert(0 == strcmp(type, sig->arguments[i].type));
+        free(type);
+        char buf[64];
+        method_getArgumentType(m, i, buf, sizeof(buf));
+        testassert(0 == strcmp(buf, sig->arguments[i].type));
+    }
+    testassert(method_copyArgumentType(m, count) == NULL);
+    char *ret = method_copyReturnType(m);
+    testassert(0 == strcmp(ret, "@"));
+    free(ret);
+
+    const char *types = method_getTypeEncoding(m);
+    uint64_t start = mach_absolute_time();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        sig = _objc_getMethodSignature(types);
+    }
+    uint64_t mid = mach_absolute_time();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        free(method_copyArgumentType(m, 3));
+    }
+    uint64_t end = mach_absolute_time();
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    testprintf("_objc_getMethodSignature: %.1f ns, "
+               "method_copyArgumentType: %.1f ns\n",
+               (double)(mid - start) * tb.numer / tb.denom / BENCH_ITERATIONS,
+               (double)(end - mid) * tb.numer / tb.denom / BENCH_ITERATIONS);
+
+    succeed(__FILE__);
+}
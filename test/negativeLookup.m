@@ -0,0 +1,89 @@
+// TEST_ENV OBJC_NEGATIVE_LOOKUP_FILTER=YES
+// TEST_CONFIG
+
+// Lookups of unimplemented selectors may be short-circuited by a
+// per-class filter. Make sure the filter never hides real methods,
+// still lets the resolver run, and learns about methods that appear,
+// including after implementations are exchanged.
+
+#include "test.h"
+#include "testroot.i"
+#include <objc/runtime.h>
+
+static int resolveCount;
+
+@interface Super : TestRoot @end
+@implementation Super
+-(int)superMethod { return 1; }
+@end
+
+@interface Sub : Super @end
+@implementation Sub
+-(int)subMethod { return 2; }
++(BOOL)resolveInstanceMethod:(SEL)sel {
+    if (sel == sel_registerName("resolved")) resolveCount++;
+    return NO;
+}
+@end
+
+static int added(id self __unused, SEL _cmd __unused) { return 3; }
+
+static SEL missingSel(int i)
+{
+    char *name;
+    asprintf(&name, "negativeLookupMissing%d", i);
+    SEL sel = sel_registerName(name);
+    free(name);
+    return sel;
+}
+
+int main()
+{
+    Sub *sub = [Sub new];
+
+    // Enough distinct misses to build filters for Sub.
+    for (int i = 0; i < 100; i++) {
+        testassert(!class_respondsToSelector([Sub class], missingSel(i)));
+    }
+
+    // Implemented methods are always found.
+    testassert(class_respondsToSelector([Sub class], @selector(subMethod)));
+    testassert(class_respondsToSelector([Sub class], @selector(superMethod)));
+    testassert(class_respondsToSelector([Sub class], @selector(retain)));
+    for (int i = 0; i < 100; i++) {
+        SEL sel = missingSel(1000 + i);
+        testassert(!class_getInstanceMethod([Sub class], sel));
+    }
+
+    // The resolver is still consulted for selectors the filter excludes.
+    SEL resolved = sel_registerName("resolved");
+    testassert(!class_getInstanceMethod([Sub class], resolved));
+    testassert(resolveCount == 1);
+    _objc_flush_caches([Sub class]);
+    testassert(!class_getInstanceMethod([Sub class], resolved));
+    testassert(resolveCount == 2);
+
+    // A method added to the superclass after the filter was built
+    // must be visible from the subclass.
+    SEL sel = missingSel(5);
+    testassert(class_addMethod([Super class], sel, (IMP)added, "i@:"));
+    testassert(class_respondsToSelector([Sub class], sel));
+    testassert(((int(*)(id, SEL))objc_msgSend)(sub, sel) == 3);
+
+    // Exchanging implementations keeps the filters. Methods added
+    // afterwards are still visible.
+    method_exchangeImplementations(class_getInstanceMethod([Sub class], @selector(subMethod)),
+                                   class_getInstanceMethod([Super class], @selector(superMethod)));
+    testassert(((int(*)(id, SEL))objc_msgSend)(sub, @selector(subMethod)) == 1);
+    for (int i = 0; i < 100; i++) {
+        testassert(!class_respondsToSelector([Sub class], missingSel(2000 + i)));
+    }
+    sel = missingSel(2005);
+    testassert(class_addMethod([Sub class], sel, (IMP)added, "i@:"));
+    testassert(class_respondsToSelector([Sub class], sel));
+    testassert(!class_respondsToSelector([Super class], sel));
+
+    RELEASE_VAR(sub);
+
+    succeed(__FILE__);
+}
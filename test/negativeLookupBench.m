@@ -0,0 +1,107 @@
+// TEST_CONFIG MEM=mrc
+
+// Times class_respondsToSelector() misses at the bottom of a deep class
+// hierarchy, without the negative lookup filter in this process and
+// with OBJC_NEGATIVE_LOOKUP_FILTER=YES in a child process.
+// There are more missing selectors than a method cache holds, so most
+// lookups take the slow path.
+
+#include "test.h"
+#include "testroot.i"
+#include <objc/runtime.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+#define DEPTH 20
+#define METHODS_PER_CLASS 20
+#define MISSING 20000
+#define ROUNDS 10
+
+static void noop(void) { }
+
+static Class makeHierarchy(void)
+{
+    Class cls = [TestRoot class];
+    for (int d = 0; d < DEPTH; d++) {
+        char name[64];
+        snprintf(name, sizeof(name), "NegativeLookupBench%d", d);
+        cls = objc_allocateClassPair(cls, name, 0);
+        testassert(cls);
+        for (int m = 0; m < METHODS_PER_CLASS; m++) {
+            snprintf(name, sizeof(name), "bench%d_%d", d, m);
+            class_addMethod(cls, sel_registerName(name), (IMP)noop, "v@:");
+        }
+        objc_registerClassPair(cls);
+    }
+    return cls;
+}
+
+static void measure(const char *label)
+{
+    Class leaf = makeHierarchy();
+    SEL *sels = (SEL *)malloc(MISSING * sizeof(SEL));
+    for (int i = 0; i < MISSING; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "benchMissing%d", i);
+        sels[i] = sel_registerName(name);
+    }
+
+    // Implemented methods anywhere in the hierarchy are found.
+    testassert(class_respondsToSelector(leaf, sel_registerName("bench0_0")));
+    testassert(class_respondsToSelector(leaf, sel_registerName("bench19_19")));
+
+    uint64_t start = mach_absolute_time();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i < MISSING; i++) {
+            testassert(!class_respondsToSelector(leaf, sels[i]));
+        }
+    }
+    uint64_t end = mach_absolute_time();
+    free(sels);
+
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    double ns = (double)(end - start) * tb.numer / tb.denom /
+        ((double)ROUNDS * MISSING);
+    testprintf("%s: %.1f ns per class_respondsToSelector miss "
+               "at depth %d\n", label, ns, DEPTH);
+}
+
+static int runWithFilter(const char *path)
+{
+    size_t count = 0;
+    while (environ[count]) count++;
+    const char **env = (const char **)calloc(count + 2, sizeof(char *));
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (0 == strncmp(environ[i], "OBJC_NEGATIVE_LOOKUP_FILTER=", 28)) continue;
+        env[n++] = environ[i];
+    }
+    env[n++] = "OBJC_NEGATIVE_LOOKUP_FILTER=YES";
+
+    const char *args[] = { path, "child", NULL };
+    pid_t pid;
+    testassertequal(posix_spawn(&pid, path, NULL, NULL,
+                                (char **)args, (char **)env), 0);
+    free(env);
+
+    int status;
+    testassertequal(waitpid(pid, &status, 0), pid);
+    return status;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1  &&  0 == strcmp(argv[1], "child")) {
+        measure("OBJC_NEGATIVE_LOOKUP_FILTER=YES");
+        return 0;
+    }
+
+    measure("OBJC_NEGATIVE_LOOKUP_FILTER=NO");
+    int status = runWithFilter(argv[0]);
+    testassert(WIFEXITED(status)  &&  WEXITSTATUS(status) == 0);
+
+    succeed(__FILE__);
+}
@@ -0,0 +1,141 @@
+// TEST_ENV OBJC_OUT_OF_LINE_RC=YES
+// TEST_CONFIG MEM=mrc
+
+// With OBJC_OUT_OF_LINE_RC, retain counts that overflow the isa are
+// kept in a per-object counter instead of the side table. Retain counts,
+// weak references and deallocation must behave as usual, including
+// under contention from many threads.
+
+#include "test.h"
+#include <objc/NSObject.h>
+#include <objc/runtime.h>
+#include <objc/objc-internal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <mach/mach_time.h>
+
+static atomic_int deallocs;
+
+@interface Counted : NSObject @end
+@implementation Counted
+-(void)dealloc { atomic_fetch_add(&deallocs, 1); [super dealloc]; }
+@end
+
+// More than the inline retain count on every architecture.
+#define LOTS (1 << 20)
+#define THREADS 8
+#define ITERATIONS 200000
+#define BATCH 1000
+
+static id shared;
+
+// Retains and releases in batches. Where extra_rc is small this moves
+// retain counts between the isa and the counter again and again.
+static void *retainReleaseShared(void *arg __unused)
+{
+    for (long i = 0; i < ITERATIONS / BATCH; i++) {
+        for (int j = 0; j < BATCH; j++) objc_retain(shared);
+        for (int j = 0; j < BATCH; j++) objc_release(shared);
+    }
+    return NULL;
+}
+
+static void *loadWeakShared(void *arg)
+{
+    id *weak = (id *)arg;
+    for (long i = 0; i < ITERATIONS; i++) {
+        id obj = objc_loadWeakRetained(weak);
+        testassert(obj == shared);
+        objc_release(obj);
+    }
+    return NULL;
+}
+
+static double contend(void *(*fn)(void *), void *arg)
+{
+    pthread_t threads[THREADS];
+    uint64_t start = mach_absolute_time();
+    for (int t = 0; t < THREADS; t++) {
+        pthread_create(&threads[t], NULL, fn, arg);
+    }
+    for (int t = 0; t < THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    uint64_t end = mach_absolute_time();
+
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    return (double)(end - start) * tb.numer / tb.denom /
+        ((double)THREADS * ITERATIONS);
+}
+
+int main()
+{
+    // Overflow, then come back down.
+    id obj = [Counted new];
+    for (long i = 0; i < LOTS; i++) objc_retain(obj);
+    testassertequal([obj retainCount], LOTS + 1);
+    for (long i = 0; i < LOTS; i++) objc_release(obj);
+    testassertequal([obj retainCount], 1);
+    testassertequal(deallocs, 0);
+    objc_release(obj);
+    testassertequal(deallocs, 1);
+
+    // Overflow twice, then release everything at once.
+    obj = [Counted new];
+    for (long i = 0; i < 2 * LOTS; i++) objc_retain(obj);
+    testassertequal([obj retainCount], 2 * LOTS + 1);
+    for (long i = 0; i < 2 * LOTS; i++) objc_release(obj);
+    objc_release(obj);
+    testassertequal(deallocs, 2);
+
+    // Weak references to an object whose counts are out of line.
+    id weak = nil;
+    obj = [Counted new];
+    for (long i = 0; i < LOTS; i++) objc_retain(obj);
+    objc_storeWeak(&weak, obj);
+    id loaded = objc_loadWeakRetained(&weak);
+    testassert(loaded == obj);
+    objc_release(loaded);
+    for (long i = 0; i < LOTS; i++) objc_release(obj);
+    objc_release(obj);
+    testassertequal(deallocs, 3);
+    testassert(objc_loadWeakRetained(&weak) == nil);
+
+    // Many threads retain and release one object across the limit.
+    shared = [Counted new];
+    for (long i = 0; i < LOTS; i++) objc_retain(shared);
+    double rr = contend(&retainReleaseShared, NULL);
+    testassertequal([shared retainCount], LOTS + 1);
+
+    // Many threads load a weak reference to it.
+    objc_storeWeak(&weak, shared);
+    double lw = contend(&loadWeakShared, &weak);
+    testassertequal([shared retainCount], LOTS + 1);
+
+    testprintf("contended: %.1f ns per retain or release, "
+               "%.1f ns per weak load and release\n", rr / 2, lw);
+
+    for (long i = 0; i < LOTS; i++) objc_release(shared);
+    objc_release(shared);
+    testassertequal(deallocs, 4);
+    testassert(objc_loadWeakRetained(&weak) == nil);
+
+    // Several objects overflow at once and die, twice over.
+    // The second group reuses the first group's counters.
+    for (int round = 0; round < 2; round++) {
+        id objs[16];
+        for (int i = 0; i < 16; i++) {
+            objs[i] = [Counted new];
+            for (long j = 0; j < LOTS; j++) objc_retain(objs[i]);
+        }
+        for (int i = 0; i < 16; i++) {
+            testassertequal([objs[i] retainCount], LOTS + 1);
+            for (long j = 0; j < LOTS; j++) objc_release(objs[i]);
+            objc_release(objs[i]);
+        }
+    }
+    testassertequal(deallocs, 4 + 32);
+
+    succeed(__FILE__);
+}
@@ -0,0 +1,60 @@
+/*
+TEST_ENV OBJC_PARALLEL_IMAGE_FIXUPS=YES
+TEST_BUILD
+    $C{COMPILE} $DIR/parallelImageFixups0.m -o parallelImageFixups0.dylib -dynamiclib
+    $C{COMPILE} $DIR/parallelImageFixups1.m -x none parallelImageFixups0.dylib -o parallelImageFixups1.dylib -dynamiclib
+    $C{COMPILE} $DIR/parallelImageFixups.m -o parallelImageFixups.exe
+END
+*/
+
+// Selector references fixed up on worker threads must still be unique
+// and must match what sel_registerName returns. The images present at
+// launch are mapped while _objc_init runs, so they are fixed up
+// serially. Opening a dylib with a dependency maps two images at once
+// after that, which uses the worker threads.
+
+#include "test.h"
+#include "testroot.i"
+#include <string.h>
+#include <dlfcn.h>
+#include <objc/runtime.h>
+
+typedef SEL (*selectors_fn)(SEL *only);
+
+@interface ParallelFixups : TestRoot
+-(int)parallelFixupsMethod;
+@end
+@implementation ParallelFixups
+-(int)parallelFixupsMethod { return 42; }
+@end
+
+int main()
+{
+    testassert(@selector(foo) == sel_registerName("foo"));
+    testassert(@selector(parallelFixupsUnique:with:) ==
+               sel_registerName("parallelFixupsUnique:with:"));
+    testassert(@selector(retain) == sel_registerName("retain"));
+    testassert(sel_isMapped(@selector(parallelFixupsUnique:with:)));
+    testassert(0 == strcmp(sel_getName(@selector(parallelFixupsMethod)),
+                           "parallelFixupsMethod"));
+
+    ParallelFixups *obj = [ParallelFixups new];
+    testassert([obj parallelFixupsMethod] == 42);
+    RELEASE_VAR(obj);
+
+    void *dlh = dlopen("parallelImageFixups1.dylib", RTLD_LAZY);
+    testassert(dlh);
+    selectors_fn from1 = (selectors_fn)dlsym(dlh, "parallelFixupsSelectors1");
+    selectors_fn from0 = (selectors_fn)dlsym(dlh, "parallelFixupsSelectorsFrom0");
+    testassert(from1  &&  from0);
+    SEL only0, only1;
+    SEL shared1 = from1(&only1);
+    SEL shared0 = from0(&only0);
+    testassert(shared0 == shared1);
+    testassert(shared0 == sel_registerName("parallelFixupsSharedSelector"));
+    testassert(only0 == sel_registerName("parallelFixupsOnlyInImage0"));
+    testassert(only1 == sel_registerName("parallelFixupsOnlyInImage1"));
+    testassert(@selector(retain) == sel_registerName("retain"));
+
+    succeed(__FILE__);
+}
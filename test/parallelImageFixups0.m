@@ -0,0 +1,7 @@
+#include <objc/runtime.h>
+
+SEL parallelFixupsSelectors0(SEL *only)
+{
+    *only = @selector(parallelFixupsOnlyInImage0);
+    return @selector(parallelFixupsSharedSelector);
+}
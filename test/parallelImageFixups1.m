@@ -0,0 +1,14 @@
+#include <objc/runtime.h>
+
+extern SEL parallelFixupsSelectors0(SEL *only);
+
+SEL parallelFixupsSelectors1(SEL *only)
+{
+    *only = @selector(parallelFixupsOnlyInImage1);
+    return @selector(parallelFixupsSharedSelector);
+}
+
+SEL parallelFixupsSelectorsFrom0(SEL *only)
+{
+    return parallelFixupsSelectors0(only);
+}
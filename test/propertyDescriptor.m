@@ -0,0 +1,150 @@
+// TEST_CONFIG MEM=mrc
+
+// _objc_property_getDescriptor() parses a property's attribute string
+// once and returns the same descriptor for equal strings. The
+// property_copyAttribute* functions are built on it and must agree.
+
+#include "test.h"
+#include "testroot.i"
+#include <objc/runtime.h>
+#include <objc/objc-internal.h>
+#include <string.h>
+#include <mach/mach_time.h>
+
+@interface Model : TestRoot {
+    id _name;
+    int _count;
+}
+@property(copy, nonatomic) id name;
+@property(readonly, getter=theCount) int count;
+@property(weak) id delegate;
+@end
+
+@implementation Model
+@synthesize name = _name;
+@synthesize count = _count;
+@dynamic delegate;
+@end
+
+#define CLASSES 50
+#define PROPERTIES 20
+#define BENCH_ITERATIONS 100
+
+int main()
+{
+    testassert(_objc_property_getDescriptor(NULL) == NULL);
+
+    objc_property_t prop = class_getProperty([Model class], "name");
+    const objc_property_descriptor *desc = _objc_property_getDescriptor(prop);
+    testassert(desc);
+    testassert(desc == _objc_property_getDescriptor(prop));
+    testassert(0 == strcmp(desc->attributes, property_getAttributes(prop)));
+    testassert(0 == strcmp(desc->type, "@"));
+    testassert(0 == strcmp(desc->ivar, "_name"));
+    testassert(desc->getter == NULL);
+    testassertequal(desc->flags, OBJC_PROPERTY_COPY | OBJC_PROPERTY_NONATOMIC);
+    testassertequal(desc->attributeCount, 4);
+    testassert(0 == strcmp(_objc_property_getAttributeValue(prop, "V"), "_name"));
+    testassert(0 == strcmp(_objc_property_getAttributeValue(prop, "N"), ""));
+    testassert(_objc_property_getAttributeValue(prop, "R") == NULL);
+    testassert(_objc_property_getAttributeValue(prop, "") == NULL);
+
+    prop = class_getProperty([Model class], "count");
+    desc = _objc_property_getDescriptor(prop);
+    testassert(0 == strcmp(desc->type, "i"));
+    testassert(0 == strcmp(desc->getter, "theCount"));
+    testassertequal(desc->flags, OBJC_PROPERTY_READONLY);
+
+    prop = class_getProperty([Model class], "delegate");
+    desc = _objc_property_getDescriptor(prop);
+    testassert(desc->ivar == NULL);
+    testassertequal(desc->flags, OBJC_PROPERTY_WEAK | OBJC_PROPERTY_DYNAMIC);
+
+    // Long names, and the copying functions.
+    objc_property_attribute_t attrs[] = {
+        { "T", "@\"NSString\"" }, { "&", "" }, { "\"long\"", "value" },
+    };
+    testassert(class_addProperty([Model class], "extra", attrs, 3));
+    prop = class_getProperty([Model class], "extra");
+    desc = _objc_property_getDescriptor(prop);
+    testassertequal(desc->attributeCount, 3);
+    testassertequal(desc->flags, OBJC_PROPERTY_RETAIN);
+    testassert(0 == strcmp(_objc_property_getAttributeValue(prop, "long"), "value"));
+    unsigned count;
+    objc_property_attribute_t *list = property_copyAttributeList(prop, &count);
+    testassertequal(count, 3);
+    for (unsigned i = 0; i < count; i++) {
+        testassert(0 == strcmp(list[i].name, desc->attributeList[i].name));
+        testassert(0 == strcmp(list[i].value, desc->attributeList[i].value));
+    }
+    testassert(list[count].name == NULL);
+    free(list);
+    char *value = property_copyAttributeValue(prop, "T");
+    testassert(0 == strcmp(value, "@\"NSString\""));
+    free(value);
+
+    // Replacing the attributes replaces the descriptor.
+    class_replaceProperty([Model class], "extra", attrs, 1);
+    desc = _objc_property_getDescriptor(prop);
+    testassertequal(desc->attributeCount, 1);
+    testassertequal(desc->flags, 0);
+    testassert(_objc_property_getAttributeValue(prop, "long") == NULL);
+
+    // A model hierarchy for the benchmark.
+    Class superclass = [TestRoot class];
+    for (int c = 0; c < CLASSES; c++) {
+        char *name;
+        asprintf(&name, "Model_%d", c);
+        Class cls = objc_allocateClassPair(superclass, name, 0);
+        free(name);
+        for (int p = 0; p < PROPERTIES; p++) {
+            char *pname, *ivar;
+            asprintf(&pname, "property_%d_%d", c, p);
+            asprintf(&ivar, "_%s", pname);
+            objc_property_attribute_t pattrs[] = {
+                { "T", "@\"NSString\"" }, { "C", "" }, { "N", "" }, { "V", ivar },
+            };
+            testassert(class_addProperty(cls, pname, pattrs, 4));
+            free(pname);
+            free(ivar);
+        }
+        objc_registerClassPair(cls);
+        superclass = cls;
+    }
+
+    uint64_t copying = 0, borrowing = 0;
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        uint64_t start = mach_absolute_time();
+        for (Class cls = superclass; cls != [TestRoot class]; cls = class_getSuperclass(cls)) {
+            objc_property_t *props = class_copyPropertyList(cls, &count);
+            for (unsigned p = 0; p < count; p++) {
+                free(property_copyAttributeValue(props[p], "T"));
+                free(property_copyAttributeValue(props[p], "V"));
+            }
+            free(props);
+        }
+        uint64_t mid = mach_absolute_time();
+        for (Class cls = superclass; cls != [TestRoot class]; cls = class_getSuperclass(cls)) {
+            objc_property_t *props = class_copyPropertyList(cls, &count);
+            testassertequal(count, PROPERTIES);
+            for (unsigned p = 0; p < count; p++) {
+                desc = _objc_property_getDescriptor(props[p]);
+                testassert(desc->type  &&  desc->ivar);
+                testassertequal(desc->flags, OBJC_PROPERTY_COPY | OBJC_PROPERTY_NONATOMIC);
+            }
+            free(props);
+        }
+        uint64_t end = mach_absolute_time();
+        copying += mid - start;
+        borrowing += end - mid;
+    }
+
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    double per = (double)tb.numer / tb.denom /
+        (BENCH_ITERATIONS * CLASSES * PROPERTIES);
+    testprintf("per property: copyAttributeValue x2 %.1f ns, "
+               "descriptor %.1f ns\n", copying * per, borrowing * per);
+
+    succeed(__FILE__);
+}
@@ -0,0 +1,130 @@
+// TEST_ENV OBJC_PROFILE_RC=YES
+// TEST_CONFIG MEM=mrc
+
+// With OBJC_PROFILE_RC, _objc_copyRCProfile() reports sampled retains and
+// releases, retain count overflows and slow deallocations per class.
+
+#include "test.h"
+#include <objc/NSObject.h>
+#include <objc/runtime.h>
+#include <objc/objc-internal.h>
+#include <pthread.h>
+
+@interface Busy : NSObject @end
+@implementation Busy @end
+
+@interface Quiet : NSObject @end
+@implementation Quiet @end
+
+// More than the inline retain count on every architecture.
+#define LOTS (1 << 20)
+#define COUNT (64 * 10000)
+#define THREADS 4
+// Sampling error, allowing for other classes' operations in between.
+#define SLACK 256
+
+static id shared;
+static char key;
+
+static objc_rc_profile_entry *find(objc_rc_profile_entry *entries,
+                                   unsigned count, Class cls)
+{
+    for (unsigned i = 0; i < count; i++) {
+        if (entries[i].cls == cls) return &entries[i];
+    }
+    return NULL;
+}
+
+static void *retainReleaseShared(void *arg __unused)
+{
+    for (long i = 0; i < COUNT; i++) {
+        objc_retain(shared);
+        objc_release(shared);
+    }
+    return NULL;
+}
+
+int main()
+{
+    // Busy gets many more retains and releases than anything else.
+    id busy = [Busy new];
+    for (long i = 0; i < COUNT; i++) {
+        objc_retain(busy);
+        objc_release(busy);
+    }
+
+    // Overflow the inline retain count, then borrow it back.
+    id quiet = [Quiet new];
+    for (long i = 0; i < LOTS; i++) objc_retain(quiet);
+    for (long i = 0; i < LOTS; i++) objc_release(quiet);
+    [quiet release];
+    for (long i = 0; i < 2 * LOTS; i++) {
+        objc_retain(busy);
+        objc_release(busy);
+    }
+
+    // Deallocations that must clear weak references and associations.
+    id weak = nil;
+    quiet = [Quiet new];
+    objc_storeWeak(&weak, quiet);
+    [quiet release];
+    testassert(objc_loadWeakRetained(&weak) == nil);
+
+    quiet = [Quiet new];
+    objc_setAssociatedObject(quiet, &key, quiet, OBJC_ASSOCIATION_ASSIGN);
+    [quiet release];
+
+    // The same, released in a batch.
+    id batch[2];
+    batch[0] = [Quiet new];
+    objc_storeWeak(&weak, batch[0]);
+    batch[1] = [Quiet new];
+    objc_setAssociatedObject(batch[1], &key, batch[1], OBJC_ASSOCIATION_ASSIGN);
+    objc_releaseObjects(batch, 2);
+    testassert(objc_loadWeakRetained(&weak) == nil);
+
+    unsigned count;
+    objc_rc_profile_entry *entries = _objc_copyRCProfile(&count);
+    testassert(entries);
+    testassert(count >= 2);
+
+    objc_rc_profile_entry *b = find(entries, count, [Busy class]);
+    objc_rc_profile_entry *q = find(entries, count, [Quiet class]);
+    testassert(b == &entries[0]);
+    testassert(q);
+
+    uint64_t total = COUNT + 2 * LOTS;
+    testprintf("Busy: %llu retains, %llu releases\n", b->retains, b->releases);
+    testassert(b->retains >= total - SLACK  &&  b->retains <= total + SLACK);
+    testassert(b->releases >= total - SLACK  &&  b->releases <= total + SLACK);
+    testassertequal(b->overflows, 0);
+    testassertequal(b->weakDeallocs, 0);
+
+    testprintf("Quiet: %llu overflows, %llu borrows\n",
+               q->overflows, q->borrows);
+    testassert(q->retains >= LOTS - SLACK);
+    testassert(q->overflows >= 1);
+    testassert(q->borrows >= 1);
+    testassertequal(q->weakDeallocs, 2);
+    testassertequal(q->assocDeallocs, 2);
+    free(entries);
+
+    // Other threads' records are counted when their buffers flush,
+    // at the latest when the threads exit.
+    shared = busy;
+    pthread_t threads[THREADS];
+    for (int t = 0; t < THREADS; t++) {
+        pthread_create(&threads[t], NULL, &retainReleaseShared, NULL);
+    }
+    for (int t = 0; t < THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    entries = _objc_copyRCProfile(&count);
+    b = find(entries, count, [Busy class]);
+    testassert(b);
+    testassert(b->retains >= total + THREADS * (COUNT - SLACK));
+    free(entries);
+
+    [busy release];
+    succeed(__FILE__);
+}
@@ -0,0 +1,138 @@
+// TEST_CONFIG MEM=mrc
+
+// objc_releaseObjects() releases each object, deallocating those that
+// reach zero, with weak references and associated objects cleared.
+
+#include "test.h"
+#include <objc/NSObject.h>
+#include <objc/runtime.h>
+#include <objc/objc-internal.h>
+#include <mach/mach_time.h>
+
+int deallocs;
+@interface CustomDealloc : NSObject @end
+@implementation CustomDealloc
+-(void)dealloc { deallocs++; [super dealloc]; }
+@end
+
+int releases;
+@interface CustomRR : NSObject @end
+@implementation CustomRR
+-(oneway void)release { releases++; [super release]; }
+@end
+
+@interface Plain : NSObject {
+    long a, b;
+}
+@end
+@implementation Plain @end
+
+static char assocKey;
+
+#define COUNT 1000
+#define BENCH_COUNT 100000
+
+static double nsPerObject(uint64_t start, uint64_t end, unsigned count)
+{
+    mach_timebase_info_data_t tb;
+    mach_timebase_info(&tb);
+    return (double)(end - start) * tb.numer / tb.denom / count;
+}
+
+int main()
+{
+    static id objs[COUNT];
+    static id weak[COUNT];
+
+    // Mix plain, weakly referenced, associated, retained, custom -dealloc,
+    // custom -release, and nil entries.
+    int expectedDeallocs = 0;
+    int expectedReleases = 0;
+    for (unsigned i = 0; i < COUNT; i++) {
+        switch (i % 7) {
+        case 0:
+            objs[i] = [Plain new];
+            break;
+        case 1:
+            objs[i] = [Plain new];
+            objc_storeWeak(&weak[i], objs[i]);
+            break;
+        case 2: {
+            objs[i] = [Plain new];
+            id value = [CustomDealloc new];
+            objc_setAssociatedObject(objs[i], &assocKey, value,
+                                     OBJC_ASSOCIATION_RETAIN);
+            [value release];
+            expectedDeallocs++;
+            break;
+        }
+        case 3:
+            objs[i] = [[Plain new] retain];
+            objc_storeWeak(&weak[i], objs[i]);
+            break;
+        case 4:
+            objs[i] = [CustomDealloc new];
+            expectedDeallocs++;
+            break;
+        case 5:
+            objs[i] = [CustomRR new];
+            expectedReleases++;
+            break;
+        case 6:
+            objs[i] = nil;
+            break;
+        }
+    }
+
+    objc_releaseObjects(objs, COUNT);
+    testassertequal(deallocs, expectedDeallocs);
+    testassertequal(releases, expectedReleases);
+    for (unsigned i = 0; i < COUNT; i++) {
+        if (i % 7 == 1) {
+            testassert(objc_loadWeak(&weak[i]) == nil);
+        } else if (i % 7 == 3) {
+            id loaded = objc_loadWeakRetained(&weak[i]);
+            testassert(loaded == objs[i]);
+            [loaded release];
+            testassertequal([objs[i] retainCount], 1);
+            objc_storeWeak(&weak[i], nil);
+            [objs[i] release];
+        }
+    }
+
+    objc_releaseObjects(NULL, 0);
+
+    // Teardown benchmark: per-object release versus objc_releaseObjects().
+    id *many = (id *)malloc(BENCH_COUNT * sizeof(id));
+
+    for (unsigned i = 0; i < BENCH_COUNT; i++) many[i] = [Plain new];
+    uint64_t start = mach_absolute_time();
+    for (unsigned i = 0; i < BENCH_COUNT; i++) [many[i] release];
+    uint64_t end = mach_absolute_time();
+    double each = nsPerObject(start, end, BENCH_COUNT);
+
+    for (unsigned i = 0; i < BENCH_COUNT; i++) many[i] = [Plain new];
+    start = mach_absolute_time();
+    objc_releaseObjects(many, BENCH_COUNT);
+    end = mach_absolute_time();
+    double batch = nsPerObject(start, end, BENCH_COUNT);
+
+    // Objects that were ever weakly referenced take the side table path.
+    for (unsigned i = 0; i < BENCH_COUNT; i++) {
+        many[i] = [Plain new];
+        if (i % 2) {
+            objc_storeWeak(&weak[0], many[i]);
+            objc_storeWeak(&weak[0], nil);
+        }
+    }
+    start = mach_absolute_time();
+    objc_releaseObjects(many, BENCH_COUNT);
+    end = mach_absolute_time();
+    double mixed = nsPerObject(start, end, BENCH_COUNT);
+
+    testprintf("release: %.1f ns each, %.1f ns batched, "
+               "%.1f ns batched with weak history\n", each, batch, mixed);
+    free(many);
+
+    succeed(__FILE__);
+}
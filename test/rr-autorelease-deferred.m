@@ -0,0 +1,12 @@
+// Test OBJC_DEFERRED_RC
+
+// TEST_ENV OBJC_DEFERRED_RC=YES
+// TEST_CFLAGS -framework Foundation
+// TEST_CONFIG MEM=mrc
+
+#include "test.h"
+
+#define FOUNDATION 0
+#define NAME "rr-autorelease-deferred"
+
+#include "rr-autorelease2.m"
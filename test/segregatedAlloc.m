@@ -0,0 +1,149 @@
+/*
+TEST_CONFIG MEM=mrc
+TEST_ENV OBJC_SEGREGATED_ALLOC=YES
+*/
+
+// Instances of classes with the default +alloc and -dealloc come from
+// size-segregated slabs under OBJC_SEGREGATED_ALLOC. Others use malloc.
+// Also compares alloc/init/release throughput and footprint of the two.
+
+#include "test.h"
+#include <objc/NSObject.h>
+#include <malloc/malloc.h>
+#include <mach/mach.h>
+#include <mach/mach_time.h>
+#include <pthread.h>
+
+@interface Small : NSObject {
+@public
+    long a, b;
+}
+@end
+@implementation Small @end
+
+@interface SmallSub : Small {
+@public
+    long c;
+}
+@end
+@implementation SmallSub @end
+
+int deallocs;
+@interface SmallDealloc : NSObject {
+@public
+    long a, b;
+}
+@end
+@implementation SmallDealloc
+-(void)dealloc { deallocs++; [super dealloc]; }
+@end
+
+@interface Big : NSObject {
+    char buf[512];
+}
+@end
+@implementation Big @end
+
+#define THREADS 4
+#define PER_THREAD 1000
+#define LOOPS 1000000
+
+static id objects[THREADS][PER_THREAD];
+
+static void *releaser(void *arg)
+{
+    id *objs = (id *)arg;
+    for (int i = 0; i < PER_THREAD; i++) {
+        [objs[i] release];
+    }
+    return NULL;
+}
+
+static bool isSlab(id obj)
+{
+    // Slab objects are not malloc blocks.
+    return malloc_size(obj) == 0;
+}
+
+static uint64_t footprint(void)
+{
+    task_vm_info_data_t info;
+    mach_msg_type_number_t count = TASK_VM_INFO_COUNT;
+    kern_return_t kr = task_info(mach_task_self(), TASK_VM_INFO,
+                                 (task_info_t)&info, &count);
+    testassert(kr == KERN_SUCCESS);
+    return info.phys_footprint;
+}
+
+#define LOOP(cls, result)                                       \
+    do {                                                        \
+        uint64_t start = mach_absolute_time();                  \
+        for (int i = 0; i < LOOPS; i++) {                       \
+            cls *obj = [[cls alloc] init];                      \
+            obj->a = i;                                         \
+            [obj release];                                      \
+        }                                                       \
+        uint64_t end = mach_absolute_time();                    \
+        mach_timebase_info_data_t tb;                           \
+        mach_timebase_info(&tb);                                \
+        result = (double)(end - start) * tb.numer / tb.denom / LOOPS; \
+    } while (0)
+
+int main()
+{
+    Small *s = [Small new];
+    SmallSub *ss = [SmallSub new];
+    SmallDealloc *sd = [SmallDealloc new];
+    Big *b = [Big new];
+
+    testassert(isSlab(s));
+    testassert(isSlab(ss));
+    testassert(!isSlab(sd));
+    testassert(!isSlab(b));
+
+    // Recycled memory is zeroed.
+    s->a = 1; s->b = 2;
+    [s release];
+    s = [Small new];
+    testassert(s->a == 0  &&  s->b == 0);
+
+    [s release];
+    [ss release];
+    [sd release];
+    testassert(deallocs == 1);
+    [b release];
+
+    // Objects freed on other threads are reused.
+    for (int t = 0; t < THREADS; t++) {
+        for (int i = 0; i < PER_THREAD; i++) {
+            objects[t][i] = [SmallSub new];
+            testassert(isSlab(objects[t][i]));
+        }
+    }
+    pthread_t threads[THREADS];
+    for (int t = 0; t < THREADS; t++) {
+        pthread_create(&threads[t], NULL, releaser, objects[t]);
+    }
+    for (int t = 0; t < THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    for (int i = 0; i < THREADS * PER_THREAD; i++) {
+        SmallSub *obj = [SmallSub new];
+        testassert(obj->a == 0  &&  obj->b == 0  &&  obj->c == 0);
+        [obj release];
+    }
+
+    double slabNs, mallocNs;
+    uint64_t fp0 = footprint();
+    LOOP(Small, slabNs);
+    uint64_t fp1 = footprint();
+    LOOP(SmallDealloc, mallocNs);
+    uint64_t fp2 = footprint();
+
+    testprintf("alloc/init/release: %.1f ns slab, %.1f ns malloc\n",
+               slabNs, mallocNs);
+    testprintf("footprint growth: %lld bytes slab, %lld bytes malloc\n",
+               (long long)(fp1 - fp0), (long long)(fp2 - fp1));
+
+    succeed(__FILE__);
+}
@@ -0,0 +1,54 @@
+/*
+TEST_ENV OBJC_RECORD_TRACE=YES
+TEST_BUILD
+    $C{COMPILE} $DIR/traceJSON.m -o traceJSON.exe
+    $C{COMPILE} $DIR/traceJSON2.m -o traceJSON2.bundle -bundle -bundle_loader traceJSON.exe
+END
+*/
+
+#include "test.h"
+#include "testroot.i"
+#include <string.h>
+#include <objc/objc-internal.h>
+
+@interface TracedLoad : TestRoot @end
+@implementation TracedLoad
++(void)load { }
+@end
+
+@interface TracedInitialize : TestRoot @end
+@implementation TracedInitialize
++(void)initialize { }
+@end
+
+int main()
+{
+    [TracedInitialize class];
+
+    // Names recorded from an image stay readable after it is unloaded.
+    void *bundle = dlopen("traceJSON2.bundle", RTLD_LAZY);
+    testassert(bundle);
+    Class unloaded = objc_getClass("TracedUnload");
+    testassert(unloaded);
+    [unloaded class];
+    testassertequal(dlclose(bundle), 0);
+
+    char *json = _objc_copyTraceJSON();
+    testassert(json);
+    testprintf("%s\n", json);
+
+    testassert(0 == strncmp(json, "{\"traceEvents\":[", 16));
+    testassert(strstr(json, "\"cat\":\"images\""));
+    testassert(strstr(json, "\"name\":\"map_images\""));
+    testassert(strstr(json, "\"name\":\"TracedLoad\",\"cat\":\"load\""));
+    testassert(strstr(json, "\"name\":\"TracedInitialize\",\"cat\":\"initialize\""));
+    testassert(strstr(json, "\"name\":\"TracedInitialize\",\"cat\":\"class\""));
+    testassert(strstr(json, "\"name\":\"TracedUnload\",\"cat\":\"load\""));
+    testassert(strstr(json, "\"name\":\"TracedUnload\",\"cat\":\"initialize\""));
+    testassert(strstr(json, "traceJSON2.bundle\",\"cat\":\"category\""));
+    testassert(strstr(json, "\"ph\":\"X\""));
+
+    free(json);
+
+    succeed(__FILE__);
+}
@@ -0,0 +1,14 @@
+#include "test.h"
+
+@interface TestRoot (TracedUnload)
+-(void)tracedUnload;
+@end
+@implementation TestRoot (TracedUnload)
+-(void)tracedUnload { }
+@end
+
+@interface TracedUnload : TestRoot @end
+@implementation TracedUnload
++(void)load { }
++(void)initialize { }
+@end